@@ -0,0 +1,169 @@
+// Times Jwt::verify against the verification it replaced (string copies,
+// a fresh HMAC per call, a json DOM for the payload), on the same token.
+//
+//   flowfund_bench_jwt [iterations]
+
+#include "Jwt.hpp"
+
+#include "nlohmann/json.hpp"
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace legacy {
+
+// Jwt.cpp's verification before it went allocation-free, kept verbatim
+// (apart from the names) as the baseline.
+
+std::string b64UrlEncode(const std::string& in) {
+  std::vector<unsigned char> bytes(in.begin(), in.end());
+  int outLen = 4 * ((static_cast<int>(bytes.size()) + 2) / 3);
+  std::string out(outLen, '\0');
+
+  EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&out[0]), bytes.data(),
+                  static_cast<int>(bytes.size()));
+
+  for (char& c : out) {
+    if (c == '+') c = '-';
+    else if (c == '/') c = '_';
+  }
+  while (!out.empty() && out.back() == '=') out.pop_back();
+  return out;
+}
+
+std::string b64UrlDecodeToString(const std::string& in) {
+  std::string b64 = in;
+
+  for (char& c : b64) {
+    if (c == '-') c = '+';
+    else if (c == '_') c = '/';
+  }
+  while (b64.size() % 4 != 0) b64.push_back('=');
+
+  std::vector<unsigned char> out((b64.size() * 3) / 4);
+
+  int n = EVP_DecodeBlock(out.data(), reinterpret_cast<const unsigned char*>(b64.data()),
+                          static_cast<int>(b64.size()));
+  if (n < 0) return "";
+
+  int pad = 0;
+  if (!b64.empty() && b64[b64.size() - 1] == '=') pad++;
+  if (b64.size() > 1 && b64[b64.size() - 2] == '=') pad++;
+
+  out.resize(static_cast<size_t>(n - pad));
+  return std::string(out.begin(), out.end());
+}
+
+std::string hmacSha256(const std::string& data, const std::string& secret) {
+  unsigned int len = 0;
+  unsigned char out[EVP_MAX_MD_SIZE];
+
+  HMAC(EVP_sha256(), secret.data(), static_cast<int>(secret.size()),
+       reinterpret_cast<const unsigned char*>(data.data()), static_cast<int>(data.size()),
+       out, &len);
+
+  return std::string(reinterpret_cast<char*>(out), len);
+}
+
+bool constantTimeEq(const std::string& a, const std::string& b) {
+  if (a.size() != b.size()) return false;
+  unsigned char diff = 0;
+  for (size_t i = 0; i < a.size(); i++) diff |= (a[i] ^ b[i]);
+  return diff == 0;
+}
+
+std::optional<Jwt::Claims> verify(const std::string& token, const std::string& secret) {
+  size_t a = token.find('.');
+  if (a == std::string::npos) return std::nullopt;
+  size_t b = token.find('.', a + 1);
+  if (b == std::string::npos) return std::nullopt;
+
+  std::string h = token.substr(0, a);
+  std::string p = token.substr(a + 1, b - (a + 1));
+  std::string s = token.substr(b + 1);
+
+  std::string signingInput = h + "." + p;
+  std::string expectedRaw = hmacSha256(signingInput, secret);
+  std::string expected = b64UrlEncode(expectedRaw);
+
+  if (!constantTimeEq(expected, s)) return std::nullopt;
+
+  std::string payloadJson = b64UrlDecodeToString(p);
+  if (payloadJson.empty()) return std::nullopt;
+
+  json payload = json::parse(payloadJson, nullptr, false);
+  if (payload.is_discarded()) return std::nullopt;
+
+  if (!payload.contains("exp") || !payload.contains("sub")) return std::nullopt;
+
+  long exp = 0;
+  try {
+    exp = payload["exp"].get<long>();
+  } catch (...) {
+    return std::nullopt;
+  }
+
+  std::time_t now = std::time(nullptr);
+  if (now >= exp) return std::nullopt;
+
+  std::string sub;
+  try {
+    sub = payload["sub"].get<std::string>();
+  } catch (...) {
+    return std::nullopt;
+  }
+
+  try {
+    return Jwt::Claims{std::stol(sub), exp};
+  } catch (...) {
+    return std::nullopt;
+  }
+}
+
+}  // namespace legacy
+
+template <class F>
+static void run(const char* name, long iterations, F verify) {
+  verify();  // warm up (thread-local MAC context, OpenSSL method lookup)
+
+  long ok = 0;
+  const auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < iterations; i++) {
+    if (verify()) ok++;
+  }
+  const auto t1 = std::chrono::steady_clock::now();
+
+  const double ns =
+      static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+  std::printf("%-8s %10.1f ns/op %12.0f ops/s\n", name, ns / iterations,
+              iterations / (ns / 1e9));
+  if (ok != iterations) {
+    std::fprintf(stderr, "%s: %ld of %ld tokens rejected\n", name, iterations - ok,
+                 iterations);
+    std::exit(1);
+  }
+}
+
+int main(int argc, char** argv) {
+  const long iterations = argc > 1 ? std::atol(argv[1]) : 1000000;
+  if (iterations <= 0) {
+    std::fprintf(stderr, "usage: %s [iterations]\n", argv[0]);
+    return 2;
+  }
+
+  const std::string secret = "bench-secret-0123456789abcdef";
+  const std::string token = Jwt::signUser(123456, secret, 60 * 60);
+
+  std::printf("%ld iterations, %zu-byte token\n", iterations, token.size());
+  run("legacy", iterations, [&] { return legacy::verify(token, secret).has_value(); });
+  run("current", iterations, [&] { return Jwt::verify(token, secret).has_value(); });
+  return 0;
+}
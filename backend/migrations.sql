@@ -19,5 +19,178 @@ CREATE TABLE IF NOT EXISTS transactions (
   created_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
 );
 
-CREATE INDEX IF NOT EXISTS idx_transactions_user_date
-  ON transactions(user_id, tx_date DESC);
+-- Keyset pagination walks (tx_date, id) per user; id breaks date ties.
+CREATE INDEX IF NOT EXISTS idx_transactions_user_date_id
+  ON transactions(user_id, tx_date DESC, id DESC);
+
+-- Superseded by idx_transactions_user_date_id (same leading columns).
+DROP INDEX IF EXISTS idx_transactions_user_date;
+
+-- GET /transactions filters (see TransactionSearch). Equality filters
+-- lead so they become index conditions; the trailing (tx_date, id) keeps
+-- the default newest-first order and its keyset cursor index-ordered.
+-- Amount sorts and amount ranges walk (amount, id).
+-- `flowfund --check-indexes` EXPLAINs every combination against these.
+CREATE INDEX IF NOT EXISTS idx_transactions_user_category_date_id
+  ON transactions(user_id, category, tx_date DESC, id DESC);
+CREATE INDEX IF NOT EXISTS idx_transactions_user_type_date_id
+  ON transactions(user_id, type, tx_date DESC, id DESC);
+CREATE INDEX IF NOT EXISTS idx_transactions_user_amount_id
+  ON transactions(user_id, amount DESC, id DESC);
+
+-- GET /transactions?q= (TransactionSearch). Words match the tsvector by
+-- prefix; misspelt merchant names fall back to trigram word similarity
+-- on the title. btree_gin puts user_id in the same GIN index, so a
+-- common word only visits the postings of the caller. 'simple' keeps
+-- merchant names unstemmed.
+CREATE EXTENSION IF NOT EXISTS btree_gin;
+CREATE EXTENSION IF NOT EXISTS pg_trgm;
+
+ALTER TABLE transactions ADD COLUMN IF NOT EXISTS search tsvector
+  GENERATED ALWAYS AS (
+    setweight(to_tsvector('simple', title), 'A') ||
+    setweight(to_tsvector('simple', category), 'B') ||
+    setweight(to_tsvector('simple', COALESCE(note, '')), 'C')
+  ) STORED;
+
+CREATE INDEX IF NOT EXISTS idx_transactions_user_search
+  ON transactions USING gin (user_id, search);
+CREATE INDEX IF NOT EXISTS idx_transactions_user_title_trgm
+  ON transactions USING gin (user_id, title gin_trgm_ops);
+
+-- Per-user running totals in cents, so GET /summary is a primary-key
+-- lookup instead of a SUM over the user's whole history. Both tables are
+-- maintained by the statement-level triggers below, inside the same
+-- transaction as the write that changed `transactions`.
+CREATE TABLE IF NOT EXISTS user_balances (
+  user_id BIGINT PRIMARY KEY REFERENCES users(id) ON DELETE CASCADE,
+  income_cents BIGINT NOT NULL DEFAULT 0,
+  expense_cents BIGINT NOT NULL DEFAULT 0,
+  tx_count BIGINT NOT NULL DEFAULT 0,
+  updated_at TIMESTAMPTZ NOT NULL DEFAULT NOW()
+);
+
+-- Same totals bucketed by calendar month (first day) and category.
+CREATE TABLE IF NOT EXISTS user_monthly_totals (
+  user_id BIGINT NOT NULL REFERENCES users(id) ON DELETE CASCADE,
+  month DATE NOT NULL,
+  category TEXT NOT NULL,
+  income_cents BIGINT NOT NULL DEFAULT 0,
+  expense_cents BIGINT NOT NULL DEFAULT 0,
+  tx_count BIGINT NOT NULL DEFAULT 0,
+  PRIMARY KEY (user_id, month, category)
+);
+
+-- Adds (sign = 1) or removes (sign = -1) a set of transaction rows from
+-- the aggregates. Rows are grouped first, so a multi-row statement (bulk
+-- import, batch) costs one upsert per user/bucket, not one per row.
+CREATE OR REPLACE FUNCTION transactions_agg_new_rows() RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+  INSERT INTO user_balances AS b (user_id, income_cents, expense_cents, tx_count)
+  SELECT user_id,
+         COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+         COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+         COUNT(*)
+  FROM new_rows GROUP BY user_id
+  ON CONFLICT (user_id) DO UPDATE SET
+    income_cents = b.income_cents + EXCLUDED.income_cents,
+    expense_cents = b.expense_cents + EXCLUDED.expense_cents,
+    tx_count = b.tx_count + EXCLUDED.tx_count,
+    updated_at = NOW();
+
+  INSERT INTO user_monthly_totals AS m
+    (user_id, month, category, income_cents, expense_cents, tx_count)
+  SELECT user_id, date_trunc('month', tx_date)::date, category,
+         COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+         COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+         COUNT(*)
+  FROM new_rows GROUP BY 1, 2, 3
+  ON CONFLICT (user_id, month, category) DO UPDATE SET
+    income_cents = m.income_cents + EXCLUDED.income_cents,
+    expense_cents = m.expense_cents + EXCLUDED.expense_cents,
+    tx_count = m.tx_count + EXCLUDED.tx_count;
+
+  RETURN NULL;
+END $$;
+
+CREATE OR REPLACE FUNCTION transactions_agg_old_rows() RETURNS trigger
+LANGUAGE plpgsql AS $$
+BEGIN
+  -- Rows removed by a cascading user delete have nothing left to update.
+  INSERT INTO user_balances AS b (user_id, income_cents, expense_cents, tx_count)
+  SELECT user_id,
+         -COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+         -COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+         -COUNT(*)
+  FROM old_rows o WHERE EXISTS (SELECT 1 FROM users u WHERE u.id = o.user_id)
+  GROUP BY user_id
+  ON CONFLICT (user_id) DO UPDATE SET
+    income_cents = b.income_cents + EXCLUDED.income_cents,
+    expense_cents = b.expense_cents + EXCLUDED.expense_cents,
+    tx_count = b.tx_count + EXCLUDED.tx_count,
+    updated_at = NOW();
+
+  INSERT INTO user_monthly_totals AS m
+    (user_id, month, category, income_cents, expense_cents, tx_count)
+  SELECT user_id, date_trunc('month', tx_date)::date, category,
+         -COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+         -COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+         -COUNT(*)
+  FROM old_rows o WHERE EXISTS (SELECT 1 FROM users u WHERE u.id = o.user_id)
+  GROUP BY 1, 2, 3
+  ON CONFLICT (user_id, month, category) DO UPDATE SET
+    income_cents = m.income_cents + EXCLUDED.income_cents,
+    expense_cents = m.expense_cents + EXCLUDED.expense_cents,
+    tx_count = m.tx_count + EXCLUDED.tx_count;
+
+  DELETE FROM user_monthly_totals m
+  USING (SELECT DISTINCT user_id FROM old_rows) o
+  WHERE m.user_id = o.user_id AND m.tx_count = 0;
+
+  RETURN NULL;
+END $$;
+
+-- Transition tables allow one event per trigger, so UPDATE gets two.
+DROP TRIGGER IF EXISTS transactions_agg_ins ON transactions;
+CREATE TRIGGER transactions_agg_ins AFTER INSERT ON transactions
+  REFERENCING NEW TABLE AS new_rows
+  FOR EACH STATEMENT EXECUTE FUNCTION transactions_agg_new_rows();
+
+DROP TRIGGER IF EXISTS transactions_agg_upd_old ON transactions;
+CREATE TRIGGER transactions_agg_upd_old AFTER UPDATE ON transactions
+  REFERENCING OLD TABLE AS old_rows
+  FOR EACH STATEMENT EXECUTE FUNCTION transactions_agg_old_rows();
+
+DROP TRIGGER IF EXISTS transactions_agg_upd_new ON transactions;
+CREATE TRIGGER transactions_agg_upd_new AFTER UPDATE ON transactions
+  REFERENCING NEW TABLE AS new_rows
+  FOR EACH STATEMENT EXECUTE FUNCTION transactions_agg_new_rows();
+
+DROP TRIGGER IF EXISTS transactions_agg_del ON transactions;
+CREATE TRIGGER transactions_agg_del AFTER DELETE ON transactions
+  REFERENCING OLD TABLE AS old_rows
+  FOR EACH STATEMENT EXECUTE FUNCTION transactions_agg_old_rows();
+
+-- One-time backfill when the aggregates are introduced on an existing
+-- database. Later drift is checked with `flowfund --verify-balances`.
+DO $$
+BEGIN
+  IF NOT EXISTS (SELECT 1 FROM user_balances)
+     AND EXISTS (SELECT 1 FROM transactions) THEN
+    INSERT INTO user_balances (user_id, income_cents, expense_cents, tx_count)
+    SELECT user_id,
+           COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+           COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+           COUNT(*)
+    FROM transactions GROUP BY user_id;
+
+    INSERT INTO user_monthly_totals
+      (user_id, month, category, income_cents, expense_cents, tx_count)
+    SELECT user_id, date_trunc('month', tx_date)::date, category,
+           COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),
+           COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),
+           COUNT(*)
+    FROM transactions GROUP BY 1, 2, 3;
+  END IF;
+END $$;
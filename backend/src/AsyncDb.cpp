@@ -0,0 +1,508 @@
+#include "AsyncDb.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <future>
+#include <iostream>
+#include <stdexcept>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "Metrics.hpp"
+
+// epoll user data for the eventfd; connections use their index.
+static constexpr uint64_t kWakeTag = UINT64_MAX;
+
+// Wait between reconnect attempts after one fails.
+static constexpr std::chrono::milliseconds kRetry{1000};
+
+// PQresetPoll has no timeout of its own (connect_timeout only applies to
+// blocking connects), so a reconnect that takes longer is abandoned.
+static constexpr std::chrono::milliseconds kConnectTimeout{5000};
+
+static AsyncDbOptions normalize(AsyncDbOptions o) {
+  o.connections = std::max(o.connections, 1);
+  o.pipelineDepth = std::max(o.pipelineDepth, 1);
+  o.maxPending = std::max(o.maxPending, 1);
+  return o;
+}
+
+// SQLSTATE 26000, as in Statements.cpp: the server dropped our prepared
+// statements (e.g. DISCARD ALL behind a pooler).
+static bool isMissingStatement(const PGresult* r) {
+  const char* state = r ? PQresultErrorField(r, PG_DIAG_SQLSTATE) : nullptr;
+  return state && std::strcmp(state, "26000") == 0;
+}
+
+// A PQsendPrepare went through, or the server already had the statement
+// (42P05 duplicate_prepared_statement).
+static bool isPrepared(const PGresult* r) {
+  if (!r) return false;
+  if (PQresultStatus(r) == PGRES_COMMAND_OK) return true;
+  const char* state = PQresultErrorField(r, PG_DIAG_SQLSTATE);
+  return state && std::strcmp(state, "42P05") == 0;
+}
+
+AsyncDb::AsyncDb(const std::string& connStr, AsyncDbOptions opts)
+    : m_opts(normalize(opts)) {
+  m_epoll = epoll_create1(EPOLL_CLOEXEC);
+  m_wake = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (m_epoll < 0 || m_wake < 0) {
+    if (m_epoll >= 0) close(m_epoll);
+    if (m_wake >= 0) close(m_wake);
+    throw std::runtime_error("AsyncDb: epoll/eventfd failed");
+  }
+  epoll_event ev{};
+  ev.events = EPOLLIN;
+  ev.data.u64 = kWakeTag;
+  epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wake, &ev);
+
+  try {
+    m_conns.resize(static_cast<size_t>(m_opts.connections));
+    for (size_t i = 0; i < m_conns.size(); i++) {
+      m_conns[i].db = std::make_unique<Db>(connStr);
+      if (!ready(i)) {
+        throw std::runtime_error(std::string("AsyncDb: pipeline setup failed: ") +
+                                 PQerrorMessage(m_conns[i].db->conn()));
+      }
+    }
+  } catch (...) {
+    m_conns.clear();
+    close(m_epoll);
+    close(m_wake);
+    throw;
+  }
+
+  m_thread = std::thread([this] { run(); });
+}
+
+AsyncDb::~AsyncDb() {
+  m_stop.store(true);
+  const uint64_t one = 1;
+  if (write(m_wake, &one, sizeof(one)) < 0) {
+    // The eventfd counter cannot overflow here; nothing to recover.
+  }
+  m_thread.join();
+
+  // Whatever never completed is failed so no waiter hangs.
+  for (Conn& c : m_conns) {
+    for (Query& q : c.inFlight) abandon(q);
+  }
+  for (Query& q : m_backlog) finish(q, nullptr);
+  for (Query& q : m_submitted) finish(q, nullptr);
+  m_conns.clear();
+  close(m_epoll);
+  close(m_wake);
+}
+
+bool AsyncDb::submit(const Sql::Statement& st, const char* const* params,
+                     int resultFormat, Callback done) {
+  if (m_pending.fetch_add(1, std::memory_order_relaxed) >= m_opts.maxPending) {
+    m_pending.fetch_sub(1, std::memory_order_relaxed);
+    m_rejected.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  Query q{&st, {}, {}, resultFormat, std::move(done)};
+  q.values.resize(static_cast<size_t>(st.nParams));
+  q.isNull.resize(static_cast<size_t>(st.nParams));
+  for (int i = 0; i < st.nParams; i++) {
+    if (params[i]) {
+      q.values[static_cast<size_t>(i)] = params[i];
+    } else {
+      q.isNull[static_cast<size_t>(i)] = true;
+    }
+  }
+
+  bool wake;
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    wake = m_submitted.empty();
+    m_submitted.push_back(std::move(q));
+  }
+  m_submittedCount.fetch_add(1, std::memory_order_relaxed);
+  if (wake) {
+    // Only the first submission since the loop last drained needs a wakeup.
+    const uint64_t one = 1;
+    if (write(m_wake, &one, sizeof(one)) < 0) {
+      // Counter saturated means a wakeup is already pending.
+    }
+  }
+  return true;
+}
+
+bool AsyncDb::exec(const Sql::Statement& st, const char* const* params,
+                   PGresult*& out, int resultFormat) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  auto promise = std::make_shared<std::promise<PGresult*>>();
+  std::future<PGresult*> result = promise->get_future();
+  if (!submit(st, params, resultFormat,
+              [promise](PGresult* r) { promise->set_value(r); })) {
+    return false;
+  }
+  out = result.get();
+  return true;
+}
+
+AsyncDb::Stats AsyncDb::stats() const {
+  Stats s;
+  s.connections = m_opts.connections;
+  s.healthy = m_healthy.load(std::memory_order_relaxed);
+  s.inFlight = m_inFlight.load(std::memory_order_relaxed);
+  s.pending = m_pending.load(std::memory_order_relaxed);
+  s.submitted = m_submittedCount.load(std::memory_order_relaxed);
+  s.completed = m_completed.load(std::memory_order_relaxed);
+  s.failed = m_failed.load(std::memory_order_relaxed);
+  s.rejected = m_rejected.load(std::memory_order_relaxed);
+  s.resets = m_resets.load(std::memory_order_relaxed);
+  return s;
+}
+
+// ---- loop thread ----
+
+void AsyncDb::run() {
+  epoll_event events[16];
+  while (!m_stop.load()) {
+    const int n = epoll_wait(m_epoll, events, 16, nextTimeoutMs());
+
+    for (int i = 0; i < n; i++) {
+      if (events[i].data.u64 == kWakeTag) {
+        uint64_t count;
+        if (read(m_wake, &count, sizeof(count)) < 0) {
+          // Already drained.
+        }
+        continue;
+      }
+      const size_t index = static_cast<size_t>(events[i].data.u64);
+      switch (m_conns[index].state) {
+        case State::Ready:
+          if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) onReadable(index);
+          if (m_conns[index].state == State::Ready && (events[i].events & EPOLLOUT)) {
+            flush(index);
+          }
+          break;
+        case State::Connecting:
+          pollReset(index);
+          break;
+        case State::Down:
+          break;
+      }
+    }
+
+    tick();
+    dispatch();
+  }
+}
+
+// Until the nearest reconnect deadline; forever when all are ready.
+int AsyncDb::nextTimeoutMs() const {
+  const auto now = std::chrono::steady_clock::now();
+  int timeout = -1;
+  for (const Conn& c : m_conns) {
+    if (c.state == State::Ready) continue;
+    const auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(c.deadline - now).count();
+    const int ms = static_cast<int>(std::max<int64_t>(0, left)) + 1;
+    if (timeout < 0 || ms < timeout) timeout = ms;
+  }
+  return timeout;
+}
+
+// Starts due reconnects and abandons ones that have taken too long.
+void AsyncDb::tick() {
+  const auto now = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < m_conns.size(); i++) {
+    Conn& c = m_conns[i];
+    if (now < c.deadline) continue;
+    if (c.state == State::Down) {
+      startReset(i);
+    } else if (c.state == State::Connecting) {
+      std::cerr << "AsyncDb: reconnect timed out\n";
+      down(i, kRetry);
+    }
+  }
+}
+
+// Moves new submissions into the backlog and sends as many as the
+// pipelines have room for.
+void AsyncDb::dispatch() {
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    while (!m_submitted.empty()) {
+      m_backlog.push_back(std::move(m_submitted.front()));
+      m_submitted.pop_front();
+    }
+  }
+
+  while (!m_backlog.empty()) {
+    Conn* c = pick();
+    if (!c) {
+      if (m_healthy.load(std::memory_order_relaxed) == 0) {
+        // Nothing to run on; fail now rather than leave callers waiting
+        // for a reconnect.
+        for (Query& q : m_backlog) finish(q, nullptr);
+        m_backlog.clear();
+      }
+      return;
+    }
+    Query q = std::move(m_backlog.front());
+    m_backlog.pop_front();
+    send(static_cast<size_t>(c - m_conns.data()), std::move(q));
+  }
+}
+
+// The ready connection with the shortest pipeline, if any has room.
+AsyncDb::Conn* AsyncDb::pick() {
+  Conn* best = nullptr;
+  for (Conn& c : m_conns) {
+    if (c.state != State::Ready ||
+        static_cast<int>(c.inFlight.size()) >= m_opts.pipelineDepth) {
+      continue;
+    }
+    if (!best || c.inFlight.size() < best->inFlight.size()) best = &c;
+  }
+  return best;
+}
+
+void AsyncDb::send(size_t index, Query q) {
+  Conn& c = m_conns[index];
+  PGconn* conn = c.db->conn();
+  const Sql::Statement& st = *q.st;
+
+  int sent;
+  if (q.prepare) {
+    sent = PQsendPrepare(conn, st.name, st.text, st.nParams, nullptr);
+  } else {
+    // Values stay in the Query so a 26000 retry can send them again.
+    std::vector<const char*> params(static_cast<size_t>(st.nParams));
+    for (size_t i = 0; i < params.size(); i++) {
+      params[i] = q.isNull[i] ? nullptr : q.values[i].c_str();
+    }
+    sent = c.db->isPrepared(st.name) && !q.retried
+               ? PQsendQueryPrepared(conn, st.name, st.nParams, params.data(), nullptr,
+                                     nullptr, q.resultFormat)
+               : PQsendQueryParams(conn, st.text, st.nParams, nullptr, params.data(),
+                                   nullptr, nullptr, q.resultFormat);
+  }
+  // One sync per query: an error aborts only that query's segment of the
+  // pipeline, not the ones queued behind it.
+  if (!sent || !PQpipelineSync(conn)) {
+    std::cerr << "AsyncDb: send failed: " << PQerrorMessage(conn) << "\n";
+    abandon(q);
+    return fail(index);
+  }
+
+  if (q.prepare) c.preparing++;
+  c.inFlight.push_back(std::move(q));
+  m_inFlight.fetch_add(1, std::memory_order_relaxed);
+  flush(index);
+}
+
+void AsyncDb::onReadable(size_t index) {
+  Conn& c = m_conns[index];
+  PGconn* conn = c.db->conn();
+  if (!PQconsumeInput(conn)) {
+    std::cerr << "AsyncDb: connection lost: " << PQerrorMessage(conn) << "\n";
+    return fail(index);
+  }
+
+  // Each query yields its result(s), a null terminator, then the result
+  // for its sync; the query completes on the sync.
+  bool lastWasNull = false;
+  while (c.state == State::Ready && !c.inFlight.empty() && !PQisBusy(conn)) {
+    PGresult* r = PQgetResult(conn);
+    if (!r) {
+      if (lastWasNull) break;
+      lastWasNull = true;
+      continue;
+    }
+    lastWasNull = false;
+
+    Query& q = c.inFlight.front();
+    if (PQresultStatus(r) == PGRES_PIPELINE_SYNC) {
+      PQclear(r);
+      Query done = std::move(q);
+      c.inFlight.pop_front();
+      m_inFlight.fetch_sub(1, std::memory_order_relaxed);
+      complete(index, std::move(done));
+    } else if (!q.result) {
+      q.result = r;
+    } else {
+      PQclear(r);  // single statements; anything after the first is noise
+    }
+  }
+
+  if (c.state != State::Ready) return;
+  if (PQstatus(conn) == CONNECTION_BAD) return fail(index);
+  if (c.events & EPOLLOUT) flush(index);
+}
+
+void AsyncDb::complete(size_t index, Query q) {
+  Conn& c = m_conns[index];
+
+  if (q.prepare) {
+    c.preparing--;
+    if (isPrepared(q.result)) {
+      c.db->markPrepared(q.st->name);
+    } else {
+      std::cerr << "AsyncDb: failed to prepare " << q.st->name << ": "
+                << (q.result ? PQresultErrorMessage(q.result) : "no result") << "\n";
+    }
+    PQclear(q.result);
+    return;
+  }
+
+  if (isMissingStatement(q.result) && !q.retried) {
+    // The server dropped our statements (restart behind a pooler,
+    // DISCARD ALL). Like Sql::exec, retry once: it goes out as text now,
+    // and the statements are prepared again behind it.
+    PQclear(q.result);
+    q.result = nullptr;
+    q.retried = true;
+    c.db->forgetPrepared();
+    if (c.preparing == 0) prepareAll(index);
+    m_backlog.push_front(std::move(q));
+    return;
+  }
+
+  finish(q, q.result);
+}
+
+void AsyncDb::flush(size_t index) {
+  Conn& c = m_conns[index];
+  const int rc = PQflush(c.db->conn());
+  if (rc < 0) return fail(index);
+  watch(index, rc == 1 ? EPOLLIN | EPOLLOUT : EPOLLIN);
+}
+
+void AsyncDb::fail(size_t index) { down(index, std::chrono::milliseconds(0)); }
+
+// Fails everything in flight on the connection and takes it out of
+// rotation; tick() starts a reconnect after `retryIn`.
+void AsyncDb::down(size_t index, std::chrono::milliseconds retryIn) {
+  Conn& c = m_conns[index];
+  if (c.state == State::Ready) m_healthy.fetch_sub(1, std::memory_order_relaxed);
+  c.state = State::Down;
+  c.deadline = std::chrono::steady_clock::now() + retryIn;
+  unwatch(index);
+  for (Query& q : c.inFlight) abandon(q);
+  m_inFlight.fetch_sub(static_cast<int>(c.inFlight.size()), std::memory_order_relaxed);
+  c.inFlight.clear();
+  c.preparing = 0;
+}
+
+// Non-blocking PQresetStart; pollReset() carries it on as the socket
+// becomes ready.
+void AsyncDb::startReset(size_t index) {
+  Conn& c = m_conns[index];
+  m_resets.fetch_add(1, std::memory_order_relaxed);
+  c.db->forgetPrepared();
+  if (!PQresetStart(c.db->conn())) {
+    std::cerr << "AsyncDb: reconnect failed: " << PQerrorMessage(c.db->conn()) << "\n";
+    return down(index, kRetry);
+  }
+  c.state = State::Connecting;
+  c.deadline = std::chrono::steady_clock::now() + kConnectTimeout;
+  // As after PQconnectStart: poll once the socket is writable.
+  watch(index, EPOLLOUT);
+}
+
+void AsyncDb::pollReset(size_t index) {
+  Conn& c = m_conns[index];
+  // libpq may close and reopen the socket (next host or address) under
+  // the same number, so register it afresh each step.
+  unwatch(index);
+  switch (PQresetPoll(c.db->conn())) {
+    case PGRES_POLLING_READING:
+      return watch(index, EPOLLIN);
+    case PGRES_POLLING_WRITING:
+      return watch(index, EPOLLOUT);
+    case PGRES_POLLING_OK:
+      if (!ready(index)) {
+        std::cerr << "AsyncDb: pipeline setup failed: " << PQerrorMessage(c.db->conn())
+                  << "\n";
+        down(index, kRetry);
+      }
+      return;
+    default:
+      std::cerr << "AsyncDb: reconnect failed: " << PQerrorMessage(c.db->conn()) << "\n";
+      return down(index, kRetry);
+  }
+}
+
+// Switches a connected socket to non-blocking pipeline mode, puts it back
+// in rotation and pipelines the statement registry behind it.
+bool AsyncDb::ready(size_t index) {
+  Conn& c = m_conns[index];
+  PGconn* conn = c.db->conn();
+  if (PQpipelineStatus(conn) != PQ_PIPELINE_OFF) PQexitPipelineMode(conn);
+  if (PQsetnonblocking(conn, 1) != 0 || PQenterPipelineMode(conn) != 1) return false;
+
+  c.state = State::Ready;
+  c.preparing = 0;
+  m_healthy.fetch_add(1, std::memory_order_relaxed);
+  watch(index, EPOLLIN);
+  prepareAll(index);
+  return true;
+}
+
+void AsyncDb::prepareAll(size_t index) {
+  for (const Sql::Statement* st : Sql::all()) {
+    if (m_conns[index].state != State::Ready) return;
+    Query q{st, {}, {}, Sql::kTextResult, nullptr};
+    q.prepare = true;
+    send(index, std::move(q));
+  }
+}
+
+// Registers the connection's current socket with `events`; libpq may
+// change sockets while (re)connecting.
+void AsyncDb::watch(size_t index, uint32_t events) {
+  Conn& c = m_conns[index];
+  const int fd = PQsocket(c.db->conn());
+  if (fd != c.fd) unwatch(index);
+  if (fd < 0) return;
+
+  epoll_event ev{};
+  ev.events = events;
+  ev.data.u64 = index;
+  if (c.fd < 0) {
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+  } else if (events != c.events && epoll_ctl(m_epoll, EPOLL_CTL_MOD, fd, &ev) != 0) {
+    // A reset reopened the socket under the same number; closing the old
+    // one dropped it from the set.
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, fd, &ev);
+  }
+  c.fd = fd;
+  c.events = events;
+}
+
+void AsyncDb::unwatch(size_t index) {
+  Conn& c = m_conns[index];
+  // Fails harmlessly if libpq already closed the socket, which also
+  // removed it from the epoll set.
+  if (c.fd >= 0) epoll_ctl(m_epoll, EPOLL_CTL_DEL, c.fd, nullptr);
+  c.fd = -1;
+  c.events = 0;
+}
+
+// Drops a query whose connection went away: callers get a null result,
+// internal prepares are just discarded.
+void AsyncDb::abandon(Query& q) {
+  PQclear(q.result);
+  q.result = nullptr;
+  if (!q.prepare) finish(q, nullptr);
+}
+
+void AsyncDb::finish(Query& q, PGresult* r) {
+  const ExecStatusType status = r ? PQresultStatus(r) : PGRES_FATAL_ERROR;
+  if (status != PGRES_TUPLES_OK && status != PGRES_COMMAND_OK) {
+    m_failed.fetch_add(1, std::memory_order_relaxed);
+  }
+  m_completed.fetch_add(1, std::memory_order_relaxed);
+  m_pending.fetch_sub(1, std::memory_order_relaxed);
+  q.result = nullptr;
+  q.done(r);
+}
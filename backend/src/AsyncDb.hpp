@@ -0,0 +1,150 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <libpq-fe.h>
+
+#include "Db.hpp"
+#include "Statements.hpp"
+
+struct AsyncDbOptions {
+  int connections = 2;
+  // Queries sent on one connection before its first result is back.
+  int pipelineDepth = 64;
+  // Submitted but not yet completed, across all connections; beyond this
+  // submit() refuses so callers can shed load.
+  int maxPending = 1024;
+};
+
+// Event-driven execution of single statements over a few connections in
+// libpq pipeline mode. One loop thread owns the connections: it sends
+// each query with PQsendQueryPrepared + PQpipelineSync without waiting for
+// the previous one, and epoll wakes it when a socket has results
+// (PQconsumeInput / PQgetResult). Reconnects are driven from the same
+// loop with PQresetStart / PQresetPoll, so a dead backend never stalls
+// the healthy connections.
+//
+// What this buys is connections, not threads: httplib handlers are
+// synchronous and wait in exec(), so statements in flight are bounded by
+// the HTTP worker count (HTTP_THREADS). Those waits share a few
+// pipelined sockets instead of holding one pooled connection each.
+//
+// Only for statements that stand alone: no transactions, COPY or cursors
+// (those keep using DbPool). Registered statements (Sql::all()) run
+// prepared once their pipelined PQsendPrepare has come back; until then,
+// and for any other Statement, they go as text with PQsendQueryParams.
+// Linux (epoll).
+class AsyncDb {
+ public:
+  // Receives the statement's first result, or null if the connection
+  // failed; the callee owns it (PQclear). Runs on the loop thread, so it
+  // must not block.
+  using Callback = std::function<void(PGresult*)>;
+
+  struct Stats {
+    int connections = 0;
+    int healthy = 0;
+    int inFlight = 0;
+    int pending = 0;
+    uint64_t submitted = 0;
+    uint64_t completed = 0;
+    uint64_t failed = 0;
+    uint64_t rejected = 0;
+    uint64_t resets = 0;
+  };
+
+  // Opens every connection; throws if one cannot connect.
+  AsyncDb(const std::string& connStr, AsyncDbOptions opts);
+  ~AsyncDb();
+
+  AsyncDb(const AsyncDb&) = delete;
+  AsyncDb& operator=(const AsyncDb&) = delete;
+
+  // Queues `st` with text `params` (copied; null entries are SQL NULL).
+  // False, without calling `done`, when maxPending is reached.
+  bool submit(const Sql::Statement& st, const char* const* params, int resultFormat,
+              Callback done);
+
+  // submit() and wait. Same contract as Sql::exec for the caller (`out` is
+  // owned by it, null on failure; a statement the server has forgotten
+  // is retried once as text), except that false means it was refused for
+  // load and nothing ran.
+  bool exec(const Sql::Statement& st, const char* const* params, PGresult*& out,
+            int resultFormat = Sql::kTextResult);
+
+  Stats stats() const;
+
+ private:
+  struct Query {
+    const Sql::Statement* st;
+    std::vector<std::string> values;
+    std::vector<bool> isNull;
+    int resultFormat;
+    Callback done;
+    PGresult* result = nullptr;
+    bool prepare = false;  // internal PQsendPrepare, no caller waiting
+    bool retried = false;  // already re-sent after SQLSTATE 26000
+  };
+
+  enum class State { Ready, Connecting, Down };
+
+  struct Conn {
+    std::unique_ptr<Db> db;
+    std::deque<Query> inFlight;  // sent, in order, each ended by a sync
+    State state = State::Down;
+    int fd = -1;          // socket registered with epoll, -1 if none
+    uint32_t events = 0;  // its epoll interest
+    int preparing = 0;    // PQsendPrepare calls awaiting their result
+    // Down: when to start the next reset. Connecting: when to give up.
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  void run();
+  int nextTimeoutMs() const;
+  void tick();
+  void dispatch();
+  Conn* pick();
+  void send(size_t index, Query q);
+  void onReadable(size_t index);
+  void complete(size_t index, Query q);
+  void flush(size_t index);
+  void fail(size_t index);
+  void down(size_t index, std::chrono::milliseconds retryIn);
+  void startReset(size_t index);
+  void pollReset(size_t index);
+  bool ready(size_t index);
+  void prepareAll(size_t index);
+  void watch(size_t index, uint32_t events);
+  void unwatch(size_t index);
+  void abandon(Query& q);
+  void finish(Query& q, PGresult* r);
+
+  const AsyncDbOptions m_opts;
+  std::vector<Conn> m_conns;  // loop thread only
+  std::deque<Query> m_backlog;  // loop thread only: waiting for a free slot
+  int m_epoll = -1;
+  int m_wake = -1;  // eventfd: new submissions or shutdown
+
+  mutable std::mutex m_mu;
+  std::deque<Query> m_submitted;
+  std::atomic<bool> m_stop{false};
+
+  std::atomic<int> m_pending{0};
+  std::atomic<int> m_inFlight{0};
+  std::atomic<int> m_healthy{0};
+  std::atomic<uint64_t> m_submittedCount{0};
+  std::atomic<uint64_t> m_completed{0};
+  std::atomic<uint64_t> m_failed{0};
+  std::atomic<uint64_t> m_rejected{0};
+  std::atomic<uint64_t> m_resets{0};
+
+  std::thread m_thread;
+};
@@ -0,0 +1,79 @@
+#include "Balances.hpp"
+
+#include <stdexcept>
+#include <string>
+
+namespace Balances {
+
+static const char* kVerifySql =
+    "WITH fresh AS ("
+    "  SELECT user_id,"
+    "    COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0) AS inc,"
+    "    COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0) AS exp,"
+    "    COUNT(*) AS n"
+    "  FROM transactions GROUP BY user_id"
+    "), fresh_monthly AS ("
+    "  SELECT user_id, date_trunc('month', tx_date)::date AS month, category,"
+    "    COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0) AS inc,"
+    "    COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0) AS exp,"
+    "    COUNT(*) AS n"
+    "  FROM transactions GROUP BY 1, 2, 3"
+    ") "
+    "SELECT"
+    " (SELECT COUNT(*) FROM fresh f FULL JOIN user_balances b USING (user_id)"
+    "  WHERE COALESCE(f.inc, 0) <> COALESCE(b.income_cents, 0)"
+    "     OR COALESCE(f.exp, 0) <> COALESCE(b.expense_cents, 0)"
+    "     OR COALESCE(f.n, 0) <> COALESCE(b.tx_count, 0)),"
+    " (SELECT COUNT(*) FROM fresh_monthly f"
+    "  FULL JOIN user_monthly_totals m USING (user_id, month, category)"
+    "  WHERE COALESCE(f.inc, 0) <> COALESCE(m.income_cents, 0)"
+    "     OR COALESCE(f.exp, 0) <> COALESCE(m.expense_cents, 0)"
+    "     OR COALESCE(f.n, 0) <> COALESCE(m.tx_count, 0))";
+
+static const char* kRebuildSql =
+    "BEGIN;"
+    "LOCK TABLE transactions IN SHARE ROW EXCLUSIVE MODE;"
+    "DELETE FROM user_balances;"
+    "DELETE FROM user_monthly_totals;"
+    "INSERT INTO user_balances (user_id, income_cents, expense_cents, tx_count)"
+    " SELECT user_id,"
+    "  COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),"
+    "  COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),"
+    "  COUNT(*)"
+    " FROM transactions GROUP BY user_id;"
+    "INSERT INTO user_monthly_totals"
+    "  (user_id, month, category, income_cents, expense_cents, tx_count)"
+    " SELECT user_id, date_trunc('month', tx_date)::date, category,"
+    "  COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0),"
+    "  COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0),"
+    "  COUNT(*)"
+    " FROM transactions GROUP BY 1, 2, 3;"
+    "COMMIT;";
+
+Drift verify(Db& db) {
+  PGresult* r = PQexec(db.conn(), kVerifySql);
+  if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
+    std::string err = PQerrorMessage(db.conn());
+    if (r) PQclear(r);
+    throw std::runtime_error("Balance verify failed: " + err);
+  }
+
+  Drift d;
+  d.users = std::stol(PQgetvalue(r, 0, 0));
+  d.buckets = std::stol(PQgetvalue(r, 0, 1));
+  PQclear(r);
+  return d;
+}
+
+void rebuild(Db& db) {
+  try {
+    db.execOrThrow(kRebuildSql);
+  } catch (...) {
+    // A failed multi-statement string leaves the transaction open.
+    PGresult* r = PQexec(db.conn(), "ROLLBACK");
+    if (r) PQclear(r);
+    throw;
+  }
+}
+
+}  // namespace Balances
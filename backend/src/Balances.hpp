@@ -0,0 +1,20 @@
+#pragma once
+#include "Db.hpp"
+
+// Maintenance for the user_balances / user_monthly_totals aggregates that
+// the transactions triggers keep up to date (see migrations.sql).
+namespace Balances {
+
+struct Drift {
+  long users = 0;    // user_balances rows that disagree with transactions
+  long buckets = 0;  // user_monthly_totals rows that disagree
+};
+
+// Recomputes every aggregate from `transactions` and compares. Read-only.
+Drift verify(Db& db);
+
+// Recomputes both tables from scratch in one transaction, holding off
+// concurrent writers to `transactions` while it runs.
+void rebuild(Db& db);
+
+}  // namespace Balances
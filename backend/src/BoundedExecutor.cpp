@@ -0,0 +1,54 @@
+#include "BoundedExecutor.hpp"
+
+#include <algorithm>
+#include <utility>
+
+BoundedExecutor::BoundedExecutor(int threads, int maxQueue)
+    : m_maxQueue(std::max(maxQueue, 0)) {
+  const int n = std::max(threads, 1);
+  m_workers.reserve(static_cast<size_t>(n));
+  for (int i = 0; i < n; i++) m_workers.emplace_back([this] { run(); });
+}
+
+BoundedExecutor::~BoundedExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    m_stopping = true;
+  }
+  m_cv.notify_all();
+  for (auto& t : m_workers) t.join();
+}
+
+bool BoundedExecutor::trySubmit(std::function<void()> task) {
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    if (m_stopping || static_cast<int>(m_queue.size()) >= m_maxQueue) {
+      m_rejected.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+    m_queue.push_back(std::move(task));
+  }
+  m_cv.notify_one();
+  return true;
+}
+
+int BoundedExecutor::queueDepth() const {
+  std::lock_guard<std::mutex> lock(m_mu);
+  return static_cast<int>(m_queue.size());
+}
+
+void BoundedExecutor::run() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock<std::mutex> lock(m_mu);
+      m_cv.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+      if (m_queue.empty()) return;  // stopping and drained
+      task = std::move(m_queue.front());
+      m_queue.pop_front();
+    }
+    m_active.fetch_add(1, std::memory_order_relaxed);
+    task();
+    m_active.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+// Fixed-size worker pool with a bounded queue. Submissions beyond the
+// queue limit are rejected immediately instead of piling up, so callers
+// can shed load (e.g. answer 503) rather than tie up request threads.
+class BoundedExecutor {
+ public:
+  BoundedExecutor(int threads, int maxQueue);
+  ~BoundedExecutor();
+
+  BoundedExecutor(const BoundedExecutor&) = delete;
+  BoundedExecutor& operator=(const BoundedExecutor&) = delete;
+
+  // Queues `task` unless the queue is full; false means rejected.
+  bool trySubmit(std::function<void()> task);
+
+  // trySubmit for a callable with a result; nullopt means rejected.
+  template <class F>
+  std::optional<std::future<std::invoke_result_t<F>>> submit(F fn) {
+    using R = std::invoke_result_t<F>;
+    auto task = std::make_shared<std::packaged_task<R()>>(std::move(fn));
+    std::future<R> fut = task->get_future();
+    if (!trySubmit([task] { (*task)(); })) return std::nullopt;
+    return fut;
+  }
+
+  int threads() const { return static_cast<int>(m_workers.size()); }
+  int maxQueue() const { return m_maxQueue; }
+  int queueDepth() const;
+  int active() const { return m_active.load(std::memory_order_relaxed); }
+  uint64_t rejected() const { return m_rejected.load(std::memory_order_relaxed); }
+
+ private:
+  void run();
+
+  const int m_maxQueue;
+  mutable std::mutex m_mu;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  bool m_stopping = false;
+  std::vector<std::thread> m_workers;
+
+  std::atomic<int> m_active{0};
+  std::atomic<uint64_t> m_rejected{0};
+};
@@ -0,0 +1,464 @@
+#include "BulkImport.hpp"
+
+#include "Metrics.hpp"
+#include "PgBinary.hpp"
+#include "Statements.hpp"
+#include "Utils/Money.hpp"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+
+namespace BulkImport {
+
+namespace {
+
+// COPY data goes to the server in chunks of about this size.
+constexpr size_t kCopyChunk = 256 * 1024;
+
+// Field values of one input row, as text, before validation. Cleared and
+// reused between rows so steady-state parsing does not allocate.
+struct RawRow {
+  std::string type, amount, currency, date, category, title, note;
+
+  void clear() {
+    for (std::string* s : {&type, &amount, &currency, &date, &category, &title, &note})
+      s->clear();
+  }
+};
+
+using Field = std::string RawRow::*;
+
+Field fieldFor(std::string_view name) {
+  if (name == "type") return &RawRow::type;
+  if (name == "amount") return &RawRow::amount;
+  if (name == "currency") return &RawRow::currency;
+  if (name == "date") return &RawRow::date;
+  if (name == "category") return &RawRow::category;
+  if (name == "title") return &RawRow::title;
+  if (name == "note") return &RawRow::note;
+  return nullptr;
+}
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+    s.remove_prefix(1);
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+    s.remove_suffix(1);
+  return s;
+}
+
+// COPY text format: backslash, tab, newline and CR must be escaped.
+void appendCopyField(std::string& out, std::string_view s) {
+  size_t run = 0;
+  for (size_t i = 0; i < s.size(); i++) {
+    const char c = s[i];
+    if (c != '\\' && c != '\t' && c != '\n' && c != '\r') continue;
+    out.append(s.data() + run, i - run);
+    run = i + 1;
+    out += '\\';
+    out += c == '\t' ? 't' : c == '\n' ? 'n' : c == '\r' ? 'r' : '\\';
+  }
+  out.append(s.data() + run, s.size() - run);
+}
+
+// Validates rows as the parsers produce them and appends the good ones
+// to the batch.
+class Collector {
+ public:
+  Collector(Parsed& out, size_t maxRows) : m_out(out), m_maxRows(maxRows) {}
+
+  // False once the upload exceeds maxRows; parsing should stop.
+  bool accept(RawRow& r) {
+    if (!count()) return false;
+    std::string err = validate(r);
+    if (!err.empty()) addError(std::move(err));
+    return true;
+  }
+
+  bool reject(std::string message) {
+    if (!count()) return false;
+    addError(std::move(message));
+    return true;
+  }
+
+ private:
+  bool count() {
+    if (++m_out.total <= m_maxRows) return true;
+    m_out.fatal = "Too many rows (max " + std::to_string(m_maxRows) + ")";
+    return false;
+  }
+
+  void addError(std::string message) {
+    m_out.errorCount++;
+    if (m_out.errors.size() < kMaxReportedErrors) {
+      m_out.errors.push_back({m_out.total, std::move(message)});
+    }
+  }
+
+  std::string validate(RawRow& r) {
+    for (const std::string* s : {&r.type, &r.amount, &r.currency, &r.date,
+                                 &r.category, &r.title, &r.note}) {
+      if (s->find('\0') != std::string::npos) return "fields must not contain NUL";
+    }
+
+    int64_t cents = 0;
+    if (trim(r.amount).empty()) return "amount required";
+    if (!utils::parseCents(r.amount, cents)) {
+      return "amount must be a decimal with at most 2 places";
+    }
+
+    std::string_view type = trim(r.type);
+    std::string upper(type);
+    std::transform(upper.begin(), upper.end(), upper.begin(),
+                   [](unsigned char c) { return std::toupper(c); });
+    if (upper.empty()) {
+      // Signed bank exports: negative is money out.
+      if (cents == 0) return "amount must not be 0";
+      upper = cents < 0 ? "EXPENSE" : "INCOME";
+      cents = cents < 0 ? -cents : cents;
+    } else if (upper != "INCOME" && upper != "EXPENSE") {
+      return "type must be INCOME or EXPENSE";
+    } else if (cents <= 0) {
+      return "amount must be > 0";
+    }
+
+    const std::string_view date = trim(r.date);
+    // Strict, so COPY never sees a date it would reject.
+    if (!PgBinary::parseDate(date)) return "date must be YYYY-MM-DD";
+    if (trim(r.category).empty()) return "category required";
+    if (trim(r.title).empty()) return "title required";
+    const std::string_view currency = trim(r.currency);
+
+    m_out.rows.add(upper, cents, currency.empty() ? "CAD" : currency, date,
+                   r.category, r.title, r.note);
+    return "";
+  }
+
+  Parsed& m_out;
+  const size_t m_maxRows;
+};
+
+// nlohmann SAX handler for `[ {row}, {row}, ... ]`. Only one row is held
+// at a time; nested values inside a row are reported, not materialised.
+class JsonRows {
+ public:
+  using json = nlohmann::json;
+
+  JsonRows(Collector& rows, Parsed& out) : m_rows(rows), m_out(out) {}
+
+  bool null() { return scalar(std::string_view()); }
+  bool boolean(bool) { return nonScalar(); }
+  bool number_integer(json::number_integer_t v) { return integer(v); }
+  bool number_unsigned(json::number_unsigned_t v) { return integer(v); }
+  bool number_float(json::number_float_t, const json::string_t& s) {
+    return scalar(s);
+  }
+  bool string(json::string_t& s) { return scalar(s); }
+  bool binary(json::binary_t&) { return nonScalar(); }
+
+  bool key(json::string_t& k) {
+    m_field = fieldFor(k);
+    m_key = k;
+    return true;
+  }
+
+  bool start_object(std::size_t) {
+    if (m_depth == 0) return fatal();
+    if (m_depth == 1) {
+      m_inRow = true;
+      m_row.clear();
+      m_rowError.clear();
+    } else if (m_depth == 2 && m_inRow) {
+      nonScalar();
+    }
+    m_depth++;
+    return true;
+  }
+
+  bool end_object() {
+    m_depth--;
+    if (m_depth != 1 || !m_inRow) return true;
+    m_inRow = false;
+    return m_rowError.empty() ? m_rows.accept(m_row) : m_rows.reject(m_rowError);
+  }
+
+  bool start_array(std::size_t) {
+    if (m_depth == 1) {
+      if (!m_rows.reject("row must be an object")) return false;
+    } else if (m_depth == 2 && m_inRow) {
+      nonScalar();
+    }
+    m_depth++;
+    return true;
+  }
+
+  bool end_array() {
+    m_depth--;
+    return true;
+  }
+
+  bool parse_error(std::size_t, const std::string&,
+                   const nlohmann::detail::exception& ex) {
+    m_out.fatal = std::string("Invalid JSON: ") + ex.what();
+    return false;
+  }
+
+ private:
+  template <class Int>
+  bool integer(Int v) {
+    char buf[24];
+    return scalar(std::string_view(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr - buf));
+  }
+
+  bool scalar(std::string_view v) {
+    if (m_depth == 0) return fatal();
+    if (m_depth == 1) return m_rows.reject("row must be an object");
+    if (m_depth == 2 && m_inRow && m_field) (m_row.*m_field).assign(v);
+    return true;
+  }
+
+  bool nonScalar() {
+    if (m_depth == 0) return fatal();
+    if (m_depth == 1) return m_rows.reject("row must be an object");
+    if (m_depth == 2 && m_inRow && m_field && m_rowError.empty()) {
+      m_rowError = m_key + " must be a string or number";
+    }
+    return true;
+  }
+
+  bool fatal() {
+    m_out.fatal = "Expected a JSON array of transactions";
+    return false;
+  }
+
+  Collector& m_rows;
+  Parsed& m_out;
+  RawRow m_row;
+  std::string m_rowError;
+  std::string m_key;
+  Field m_field = nullptr;
+  int m_depth = 0;
+  bool m_inRow = false;
+};
+
+// RFC 4180-style records: comma separated, optional double quotes with ""
+// as an escaped quote, LF or CRLF line ends, newlines allowed in quotes.
+class CsvReader {
+ public:
+  explicit CsvReader(std::string_view s) : m_s(s) {
+    if (m_s.substr(0, 3) == "\xEF\xBB\xBF") m_s.remove_prefix(3);  // Excel BOM
+  }
+
+  // False at end of input or on an unterminated quote (see error()).
+  bool next(std::vector<std::string>& fields) {
+    if (m_pos >= m_s.size()) return false;
+    size_t n = 0;
+    for (;;) {
+      if (n == fields.size()) fields.emplace_back();
+      std::string& f = fields[n++];
+      f.clear();
+      if (m_pos < m_s.size() && m_s[m_pos] == '"') {
+        m_pos++;
+        for (;;) {
+          const size_t q = m_s.find('"', m_pos);
+          if (q == std::string_view::npos) {
+            m_error = true;
+            return false;
+          }
+          f.append(m_s.data() + m_pos, q - m_pos);
+          m_pos = q + 1;
+          if (m_pos < m_s.size() && m_s[m_pos] == '"') {
+            f += '"';
+            m_pos++;
+            continue;
+          }
+          break;
+        }
+      }
+      const size_t end = m_s.find_first_of(",\n", m_pos);
+      const size_t stop = end == std::string_view::npos ? m_s.size() : end;
+      f.append(m_s.data() + m_pos, stop - m_pos);
+      m_pos = stop + 1;
+      if (end != std::string_view::npos && m_s[end] == ',') continue;
+      if (!f.empty() && f.back() == '\r') f.pop_back();
+      fields.resize(n);
+      return true;
+    }
+  }
+
+  bool error() const { return m_error; }
+
+ private:
+  std::string_view m_s;
+  size_t m_pos = 0;
+  bool m_error = false;
+};
+
+// "COPY transactions, line 42, column amount: ..." -> 42. 0 when the
+// error is not tied to an input row: a failure in the balance triggers
+// has its own PL/pgSQL "line N" context, which must not be blamed on row N.
+size_t copyLine(const PGresult* r) {
+  static constexpr char kPrefix[] = "COPY transactions, line ";
+  const char* ctx = r ? PQresultErrorField(r, PG_DIAG_CONTEXT) : nullptr;
+  const char* at = ctx ? std::strstr(ctx, kPrefix) : nullptr;
+  return at ? static_cast<size_t>(std::strtoul(at + sizeof(kPrefix) - 1, nullptr, 10))
+            : 0;
+}
+
+std::string primaryMessage(const PGresult* r, PGconn* c) {
+  const char* m = r ? PQresultErrorField(r, PG_DIAG_MESSAGE_PRIMARY) : nullptr;
+  return m ? m : PQerrorMessage(c);
+}
+
+}  // namespace
+
+void Batch::add(std::string_view type, int64_t amountCents,
+                std::string_view currency, std::string_view date,
+                std::string_view category, std::string_view title,
+                std::string_view note) {
+  m_data.append(type);
+  m_data += '\t';
+  utils::appendCents(m_data, amountCents);
+  for (std::string_view f : {currency, date, category, title, note}) {
+    m_data += '\t';
+    appendCopyField(m_data, f);
+  }
+  m_data += '\n';
+  m_ends.push_back(m_data.size());
+}
+
+std::string_view Batch::line(size_t i) const {
+  const size_t begin = i == 0 ? 0 : m_ends[i - 1];
+  return std::string_view(m_data).substr(begin, m_ends[i] - begin);
+}
+
+Parsed parseJson(std::string_view body, size_t maxRows) {
+  Parsed out;
+  Collector rows(out, maxRows);
+  JsonRows handler(rows, out);
+  if (!nlohmann::json::sax_parse(body.begin(), body.end(), &handler) &&
+      out.fatal.empty()) {
+    out.fatal = "Invalid JSON";
+  }
+  return out;
+}
+
+Parsed parseCsv(std::string_view body, size_t maxRows) {
+  Parsed out;
+  Collector rows(out, maxRows);
+  CsvReader reader(body);
+
+  std::vector<std::string> fields;
+  if (!reader.next(fields)) {
+    out.fatal = reader.error() ? "Unterminated quote in CSV" : "Empty CSV";
+    return out;
+  }
+  std::vector<Field> columns;
+  for (std::string& name : fields) {
+    std::string lower(trim(name));
+    std::transform(lower.begin(), lower.end(), lower.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    columns.push_back(fieldFor(lower));
+  }
+  if (std::find(columns.begin(), columns.end(), &RawRow::amount) == columns.end()) {
+    out.fatal = "CSV header must name an amount column";
+    return out;
+  }
+
+  RawRow row;
+  while (reader.next(fields)) {
+    if (fields.size() == 1 && trim(fields[0]).empty()) continue;  // blank line
+    row.clear();
+    for (size_t i = 0; i < fields.size() && i < columns.size(); i++) {
+      if (columns[i]) row.*columns[i] = std::move(fields[i]);
+    }
+    if (!rows.accept(row)) return out;
+  }
+  if (reader.error()) out.fatal = "Unterminated quote in CSV";
+  return out;
+}
+
+Result load(Db& db, long userId, const Batch& rows) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  Result res;
+  if (rows.size() == 0) return res;
+  PGconn* c = db.conn();
+
+  auto fail = [&](PGresult* r) {
+    res.error = primaryMessage(r, c);
+    if (r) PQclear(r);
+    PQclear(PQexec(c, "ROLLBACK"));
+    return res;
+  };
+
+  PGresult* r = PQexec(c, "BEGIN");
+  if (!r || PQresultStatus(r) != PGRES_COMMAND_OK) return fail(r);
+  PQclear(r);
+
+  const std::string count = std::to_string(rows.size());
+  const char* params[1] = {count.c_str()};
+  r = Sql::exec(db, Sql::kReserveTransactionIds, params, Sql::kBinaryResult);
+  if (!r || PQresultStatus(r) != PGRES_TUPLES_OK ||
+      static_cast<size_t>(PQntuples(r)) != rows.size()) {
+    return fail(r);
+  }
+  std::vector<int64_t> ids(rows.size());
+  for (size_t i = 0; i < ids.size(); i++) {
+    ids[i] = PgBinary::int8(r, static_cast<int>(i), 0);
+  }
+  PQclear(r);
+
+  r = PQexec(c,
+             "COPY transactions(id,user_id,type,amount,currency,tx_date,"
+             "category,title,note) FROM STDIN");
+  if (!r || PQresultStatus(r) != PGRES_COPY_IN) return fail(r);
+  PQclear(r);
+
+  const std::string user = std::to_string(userId);
+  std::string buf;
+  buf.reserve(kCopyChunk + 1024);
+  bool sent = true;
+  for (size_t i = 0; i < rows.size() && sent; i++) {
+    char idBuf[24];
+    buf.append(idBuf, std::to_chars(idBuf, idBuf + sizeof(idBuf), ids[i]).ptr);
+    buf += '\t';
+    buf += user;
+    buf += '\t';
+    buf += rows.line(i);
+    if (buf.size() >= kCopyChunk) {
+      sent = PQputCopyData(c, buf.data(), static_cast<int>(buf.size())) == 1;
+      buf.clear();
+    }
+  }
+  if (sent && !buf.empty()) {
+    sent = PQputCopyData(c, buf.data(), static_cast<int>(buf.size())) == 1;
+  }
+  PQputCopyEnd(c, sent ? nullptr : "client send failed");
+
+  // The COPY's own result, then the end-of-command null.
+  r = PQgetResult(c);
+  const bool copied = r && PQresultStatus(r) == PGRES_COMMAND_OK;
+  if (!copied) res.failedRow = copyLine(r);
+  for (PGresult* extra; (extra = PQgetResult(c));) PQclear(extra);
+  if (!copied) return fail(r);
+  PQclear(r);
+
+  r = PQexec(c, "COMMIT");
+  if (!r || PQresultStatus(r) != PGRES_COMMAND_OK) return fail(r);
+  PQclear(r);
+
+  for (int64_t id : ids) {
+    if (!res.ids.empty() && res.ids.back().second + 1 == id) {
+      res.ids.back().second = id;
+    } else {
+      res.ids.emplace_back(id, id);
+    }
+  }
+  return res;
+}
+
+}  // namespace BulkImport
@@ -0,0 +1,65 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "Db.hpp"
+
+// POST /transactions/bulk: parse and validate a whole upload in one pass,
+// then load it with COPY ... FROM STDIN in a single transaction. Either
+// every row goes in or none does.
+namespace BulkImport {
+
+struct RowError {
+  size_t row = 0;  // 1-based data row (CSV header not counted)
+  std::string message;
+};
+
+// Rows that passed validation, kept as COPY text lines without the
+// leading id column (ids are only known once they are reserved).
+class Batch {
+ public:
+  void add(std::string_view type, int64_t amountCents, std::string_view currency,
+           std::string_view date, std::string_view category,
+           std::string_view title, std::string_view note);
+
+  size_t size() const { return m_ends.size(); }
+  std::string_view line(size_t i) const;
+
+ private:
+  std::string m_data;
+  std::vector<size_t> m_ends;
+};
+
+struct Parsed {
+  Batch rows;
+  size_t total = 0;               // data rows seen, valid or not
+  std::vector<RowError> errors;   // first kMaxReportedErrors only
+  size_t errorCount = 0;
+  std::string fatal;              // malformed body / too many rows
+};
+
+inline constexpr size_t kMaxReportedErrors = 100;
+
+// JSON: an array of objects shaped like POST /transactions bodies.
+// CSV: a header row naming the columns (type, amount, currency, date,
+// category, title, note; any order, unknown columns ignored).
+// In both, a missing type is taken from the sign of amount, so signed
+// bank exports load as-is.
+Parsed parseJson(std::string_view body, size_t maxRows);
+Parsed parseCsv(std::string_view body, size_t maxRows);
+
+struct Result {
+  // Assigned ids, collapsed into inclusive [first, last] ranges. Usually
+  // one range; concurrent inserts can interleave with the reservation.
+  std::vector<std::pair<int64_t, int64_t>> ids;
+  std::string error;   // empty on success
+  size_t failedRow = 0;  // 1-based row Postgres rejected, 0 if unknown
+};
+
+Result load(Db& db, long userId, const Batch& rows);
+
+}  // namespace BulkImport
@@ -0,0 +1,144 @@
+#include "Compression.hpp"
+
+#include <cctype>
+#include <cstdlib>
+
+#ifdef FLOWFUND_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#include "Gzip.hpp"
+
+namespace {
+
+// Level 5 costs about half of zlib's default (6) for nearly the same
+// ratio on JSON.
+constexpr int kGzipLevel = 5;
+#ifdef FLOWFUND_BROTLI
+// Brotli 5 already beats gzip -9 on JSON at gzip-like speed; the top
+// levels are for static assets, not per-request bodies.
+constexpr int kBrotliQuality = 5;
+#endif
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+  return s;
+}
+
+bool iequals(std::string_view a, std::string_view b) {
+  if (a.size() != b.size()) return false;
+  for (size_t i = 0; i < a.size(); i++) {
+    if (std::tolower(static_cast<unsigned char>(a[i])) !=
+        std::tolower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// q value of one Accept-Encoding element's parameters; 1 when absent.
+double qValue(std::string_view params) {
+  while (!params.empty()) {
+    const size_t semi = params.find(';');
+    const std::string_view p = trim(params.substr(0, semi));
+    if (p.size() > 2 && (p[0] == 'q' || p[0] == 'Q') && p[1] == '=') {
+      return std::strtod(std::string(p.substr(2)).c_str(), nullptr);
+    }
+    if (semi == std::string_view::npos) break;
+    params.remove_prefix(semi + 1);
+  }
+  return 1.0;
+}
+
+void gzip(std::string& body) {
+  // One deflate state per server thread: deflateInit allocates ~256 KB,
+  // which would otherwise be paid on every response.
+  thread_local GzipStream stream(kGzipLevel);
+  stream.reset();
+  std::string out;
+  out.reserve(body.size() / 4 + 64);
+  stream.write(body, out);
+  stream.finish(out);
+  body.swap(out);
+}
+
+#ifdef FLOWFUND_BROTLI
+bool brotli(std::string& body) {
+  size_t size = BrotliEncoderMaxCompressedSize(body.size());
+  if (size == 0) return false;
+  std::string out(size, '\0');
+  if (!BrotliEncoderCompress(kBrotliQuality, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT,
+                             body.size(), reinterpret_cast<const uint8_t*>(body.data()),
+                             &size, reinterpret_cast<uint8_t*>(out.data()))) {
+    return false;
+  }
+  out.resize(size);
+  body.swap(out);
+  return true;
+}
+#endif
+
+}  // namespace
+
+namespace Compression {
+
+bool accepts(std::string_view acceptEncoding, std::string_view coding) {
+  double q = 0;
+  bool listed = false;
+  while (!acceptEncoding.empty()) {
+    const size_t comma = acceptEncoding.find(',');
+    const std::string_view element = acceptEncoding.substr(0, comma);
+    const size_t semi = element.find(';');
+    const std::string_view name = trim(element.substr(0, semi));
+    const std::string_view params =
+        semi == std::string_view::npos ? std::string_view() : element.substr(semi + 1);
+    // An explicit entry wins over "*" wherever either appears.
+    if (iequals(name, coding)) {
+      q = qValue(params);
+      listed = true;
+    } else if (name == "*" && !listed) {
+      q = qValue(params);
+    }
+    if (comma == std::string_view::npos) break;
+    acceptEncoding.remove_prefix(comma + 1);
+  }
+  return q > 0;
+}
+
+Encoding negotiate(std::string_view acceptEncoding) {
+  if (acceptEncoding.empty()) return Encoding::Identity;
+#ifdef FLOWFUND_BROTLI
+  if (accepts(acceptEncoding, "br")) return Encoding::Brotli;
+#endif
+  if (accepts(acceptEncoding, "gzip")) return Encoding::Gzip;
+  return Encoding::Identity;
+}
+
+const char* token(Encoding e) {
+  switch (e) {
+    case Encoding::Gzip:
+      return "gzip";
+    case Encoding::Brotli:
+      return "br";
+    case Encoding::Identity:
+      break;
+  }
+  return "";
+}
+
+Encoding apply(Encoding e, std::string& body) {
+  if (e == Encoding::Identity || body.size() < kMinBytes) return Encoding::Identity;
+#ifdef FLOWFUND_BROTLI
+  if (e == Encoding::Brotli) {
+    // No gzip fallback: the client may have accepted br alone. brotli()
+    // leaves the body untouched on failure.
+    return brotli(body) ? Encoding::Brotli : Encoding::Identity;
+  }
+#endif
+  if (e != Encoding::Gzip) return Encoding::Identity;
+  gzip(body);
+  return Encoding::Gzip;
+}
+
+}  // namespace Compression
@@ -0,0 +1,33 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Content-Encoding negotiation and whole-body compression for JSON
+// responses. gzip is always available; brotli when built with
+// libbrotlienc (FLOWFUND_BROTLI).
+namespace Compression {
+
+enum class Encoding { Identity, Gzip, Brotli };
+
+// Bodies smaller than this go out as they are: below ~1 KB the headers
+// dominate and compression can even grow the payload.
+inline constexpr size_t kMinBytes = 1024;
+
+// Whether `acceptEncoding` allows `coding` ("gzip", "br") with q > 0.
+bool accepts(std::string_view acceptEncoding, std::string_view coding);
+
+// The best encoding this build supports that the client accepts;
+// brotli over gzip.
+Encoding negotiate(std::string_view acceptEncoding);
+
+// Content-Encoding token; empty for Identity.
+const char* token(Encoding e);
+
+// Compresses `body` in place when it is at least kMinBytes and `e` is
+// not Identity. Returns the encoding the body ends up in. gzip reuses a
+// per-thread deflate stream, so steady state does not reallocate zlib's
+// window.
+Encoding apply(Encoding e, std::string& body);
+
+}  // namespace Compression
@@ -0,0 +1,30 @@
+#include "ConcurrencyLimiter.hpp"
+
+ConcurrencyLimiter::Permit::~Permit() {
+  if (m_owner) m_owner->release(m_key);
+}
+
+std::optional<ConcurrencyLimiter::Permit> ConcurrencyLimiter::tryAcquire(
+    const std::string& key) {
+  std::lock_guard<std::mutex> lock(m_mu);
+  int& n = m_inFlight[key];
+  if (n >= m_maxPerKey) {
+    m_rejected++;
+    if (n == 0) m_inFlight.erase(key);
+    return std::nullopt;
+  }
+  n++;
+  return std::optional<Permit>(std::in_place, this, key);
+}
+
+uint64_t ConcurrencyLimiter::rejected() const {
+  std::lock_guard<std::mutex> lock(m_mu);
+  return m_rejected;
+}
+
+void ConcurrencyLimiter::release(const std::string& key) {
+  std::lock_guard<std::mutex> lock(m_mu);
+  auto it = m_inFlight.find(key);
+  if (it == m_inFlight.end()) return;
+  if (--it->second <= 0) m_inFlight.erase(it);
+}
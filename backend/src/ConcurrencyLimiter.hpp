@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+
+// Caps how many requests may be in flight at once for the same key
+// (client IP, account email, ...). A Permit holds one slot until it is
+// destroyed; keys with no holders are dropped so the map stays small.
+class ConcurrencyLimiter {
+ public:
+  class Permit {
+   public:
+    Permit(ConcurrencyLimiter* owner, std::string key)
+        : m_owner(owner), m_key(std::move(key)) {}
+    ~Permit();
+
+    Permit(Permit&& o) noexcept : m_owner(o.m_owner), m_key(std::move(o.m_key)) {
+      o.m_owner = nullptr;
+    }
+    Permit& operator=(Permit&&) = delete;
+    Permit(const Permit&) = delete;
+    Permit& operator=(const Permit&) = delete;
+
+   private:
+    ConcurrencyLimiter* m_owner;
+    std::string m_key;
+  };
+
+  explicit ConcurrencyLimiter(int maxPerKey) : m_maxPerKey(maxPerKey) {}
+
+  // nullopt when `key` already has maxPerKey permits outstanding.
+  std::optional<Permit> tryAcquire(const std::string& key);
+
+  uint64_t rejected() const;
+
+ private:
+  void release(const std::string& key);
+
+  const int m_maxPerKey;
+  mutable std::mutex m_mu;
+  std::unordered_map<std::string, int> m_inFlight;
+  uint64_t m_rejected = 0;
+};
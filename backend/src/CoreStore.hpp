@@ -0,0 +1,52 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "TransactionRow.hpp"
+#include "TransactionSearch.hpp"
+
+// Data calls behind the routes every backend serves: register, login,
+// create/list/delete transactions and the summary. The handlers (main.cpp)
+// parse, validate and answer; a store only touches its database and
+// reports how that went.
+class CoreStore {
+ public:
+  enum class Status {
+    Ok,
+    Missing,      // email taken (createUser), unknown user or row
+    Unsupported,  // a list filter this backend does not implement
+    Busy,         // saturated; the client should retry
+    Failed,
+  };
+
+  struct User {
+    long id = 0;
+    std::string passwordHash;
+  };
+
+  // Validated by the handler: type is INCOME/EXPENSE, amount > 0, date
+  // is YYYY-MM-DD.
+  struct NewTransaction {
+    std::string type;
+    int64_t amountCents = 0;
+    std::string currency, date, category, title, note;
+  };
+
+  virtual ~CoreStore() = default;
+
+  virtual Status createUser(const std::string& name, const std::string& email,
+                            const std::string& passwordHash, long& id) = 0;
+  virtual Status findUser(const std::string& email, User& user) = 0;
+
+  virtual Status insertTransaction(long userId, const NewTransaction& t, long& id) = 0;
+  virtual Status deleteTransaction(long userId, long id) = 0;
+
+  // Calls `each` for up to f.pageSize + 1 rows in f.sort order, so the
+  // caller can tell whether a next page exists. The row's views are only
+  // valid during the callback.
+  virtual Status listTransactions(long userId, const TransactionSearch::Filters& f,
+                                  const std::function<void(const TransactionRow&)>& each) = 0;
+
+  virtual Status summary(long userId, int64_t& incomeCents, int64_t& expenseCents) = 0;
+};
@@ -0,0 +1,85 @@
+#include "CorsPolicy.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <utility>
+
+namespace {
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front())))
+    s.remove_prefix(1);
+  while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back())))
+    s.remove_suffix(1);
+  return s;
+}
+
+bool isHostChar(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '-' ||
+         c == '.';
+}
+
+}  // namespace
+
+CorsPolicy::CorsPolicy(std::string spec) : m_spec(std::move(spec)) {
+  // Origins compare case-insensitively; browsers send them lower-cased.
+  std::transform(m_spec.begin(), m_spec.end(), m_spec.begin(),
+                 [](unsigned char c) { return std::tolower(c); });
+
+  bool any = false;
+  std::string_view rest = m_spec;
+  while (!rest.empty()) {
+    const size_t comma = rest.find(',');
+    std::string_view item = trim(rest.substr(0, comma));
+    rest = comma == std::string_view::npos ? std::string_view()
+                                           : rest.substr(comma + 1);
+
+    // "https://a.com/" is a common typo for the origin "https://a.com".
+    while (!item.empty() && item.back() == '/') item.remove_suffix(1);
+    if (item.empty()) continue;
+
+    if (item == "*") {
+      any = true;
+      continue;
+    }
+    const size_t star = item.find("://*.");
+    if (star != std::string_view::npos) {
+      m_wildcards.push_back({item.substr(0, star + 3), item.substr(star + 4)});
+    } else {
+      m_exact.insert(item);
+    }
+  }
+
+  if (any) m_mode = Mode::Any;
+  else if (!m_exact.empty() || !m_wildcards.empty()) m_mode = Mode::List;
+}
+
+std::string_view CorsPolicy::allowOrigin(std::string_view requestOrigin) const {
+  switch (m_mode) {
+    case Mode::Disabled:
+      return {};
+    case Mode::Any:
+      // Echo the request Origin when present for best browser compatibility.
+      return requestOrigin.empty() ? std::string_view("*") : requestOrigin;
+    case Mode::List:
+      break;
+  }
+  if (requestOrigin.empty()) return {};
+  if (m_exact.count(requestOrigin)) return requestOrigin;
+  for (const auto& w : m_wildcards) {
+    if (matches(w, requestOrigin)) return requestOrigin;
+  }
+  return {};
+}
+
+// The wildcard stands for one or more subdomain labels, never for the
+// bare domain itself and never for anything that carries a port or path.
+bool CorsPolicy::matches(const Wildcard& w, std::string_view origin) {
+  if (origin.size() <= w.prefix.size() + w.suffix.size()) return false;
+  if (origin.substr(0, w.prefix.size()) != w.prefix) return false;
+  if (origin.substr(origin.size() - w.suffix.size()) != w.suffix) return false;
+  const std::string_view host = origin.substr(
+      w.prefix.size(), origin.size() - w.prefix.size() - w.suffix.size());
+  if (host.front() == '.' || host.back() == '.') return false;
+  return std::all_of(host.begin(), host.end(), isHostChar);
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+// CORS_ORIGIN parsed once at startup. The spec can be:
+//   - empty: CORS disabled
+//   - "*": allow any origin (the request Origin is echoed when present)
+//   - a comma-separated list of exact origins and/or wildcard subdomain
+//     patterns, e.g. "https://hetansh2744.github.io,https://*.onrender.com"
+//
+// Lookups never allocate: the hashed set and the patterns are views into
+// the policy's own copy of the spec, so the policy cannot be copied.
+// We do NOT use cookies, so there is no Allow-Credentials support.
+class CorsPolicy {
+ public:
+  explicit CorsPolicy(std::string spec);
+
+  CorsPolicy(const CorsPolicy&) = delete;
+  CorsPolicy& operator=(const CorsPolicy&) = delete;
+
+  // Value for Access-Control-Allow-Origin: `requestOrigin` itself or "*"
+  // when allowed, empty when CORS is off or the origin is not allowed.
+  std::string_view allowOrigin(std::string_view requestOrigin) const;
+
+  bool enabled() const { return m_mode != Mode::Disabled; }
+
+  // Fixed preflight header values.
+  const std::string& allowHeaders() const { return m_allowHeaders; }
+  const std::string& allowMethods() const { return m_allowMethods; }
+  const std::string& maxAge() const { return m_maxAge; }
+
+ private:
+  enum class Mode { Disabled, Any, List };
+
+  // "https://*.example.com" -> prefix "https://", suffix ".example.com".
+  struct Wildcard {
+    std::string_view prefix;
+    std::string_view suffix;
+  };
+
+  static bool matches(const Wildcard& w, std::string_view origin);
+
+  std::string m_spec;  // lower-cased; m_exact and m_wildcards point into it
+  Mode m_mode = Mode::Disabled;
+  std::unordered_set<std::string_view> m_exact;
+  std::vector<Wildcard> m_wildcards;
+
+  const std::string m_allowHeaders = "Content-Type, Authorization";
+  const std::string m_allowMethods = "GET, POST, PUT, PATCH, DELETE, OPTIONS";
+  const std::string m_maxAge = "86400";
+};
@@ -0,0 +1,86 @@
+#include "Cursor.hpp"
+
+#include <openssl/evp.h>
+
+namespace Cursor {
+
+// Date:   int32 date + int64 id, big endian (12 bytes, 16 chars).
+// Amount: 'A', 0, int64 cents, int64 id (18 bytes, 24 chars).
+// Offset: 'O', 0, int64 offset, int64 id (18 bytes, 24 chars).
+// Both lengths are multiples of 3, so neither needs base64 padding.
+static constexpr int kDateRawLen = 12;
+static constexpr int kAmountRawLen = 18;
+static constexpr int kMaxRawLen = kAmountRawLen;
+
+static void putBe(unsigned char* p, uint64_t v, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    p[i] = static_cast<unsigned char>(v >> (8 * (bytes - 1 - i)));
+  }
+}
+
+static uint64_t getBe(const unsigned char* p, int bytes) {
+  uint64_t v = 0;
+  for (int i = 0; i < bytes; i++) v = (v << 8) | p[i];
+  return v;
+}
+
+std::string encode(const Position& pos) {
+  unsigned char raw[kMaxRawLen];
+  int len = 0;
+  if (pos.key == Key::Date) {
+    putBe(raw, static_cast<uint32_t>(pos.value), 4);
+    putBe(raw + 4, static_cast<uint64_t>(pos.id), 8);
+    len = kDateRawLen;
+  } else {
+    raw[0] = pos.key == Key::Amount ? 'A' : 'O';
+    raw[1] = 0;
+    putBe(raw + 2, static_cast<uint64_t>(pos.value), 8);
+    putBe(raw + 10, static_cast<uint64_t>(pos.id), 8);
+    len = kAmountRawLen;
+  }
+
+  unsigned char b64[kMaxRawLen / 3 * 4 + 1];
+  const int n = EVP_EncodeBlock(b64, raw, len);
+
+  std::string out(reinterpret_cast<char*>(b64), static_cast<size_t>(n));
+  for (char& c : out) {
+    if (c == '+') c = '-';
+    else if (c == '/') c = '_';
+  }
+  return out;
+}
+
+std::optional<Position> decode(const std::string& token) {
+  const int n = static_cast<int>(token.size());
+  if (n != kDateRawLen / 3 * 4 && n != kAmountRawLen / 3 * 4) return std::nullopt;
+
+  unsigned char b64[kMaxRawLen / 3 * 4];
+  for (int i = 0; i < n; i++) {
+    char c = token[i];
+    if (c == '-') c = '+';
+    else if (c == '_') c = '/';
+    else if (c == '+' || c == '/' || c == '=') return std::nullopt;
+    b64[i] = static_cast<unsigned char>(c);
+  }
+
+  unsigned char raw[kMaxRawLen];
+  const int len = EVP_DecodeBlock(raw, b64, n);
+
+  Position pos;
+  if (len == kDateRawLen && n == kDateRawLen / 3 * 4) {
+    pos.key = Key::Date;
+    pos.value = static_cast<int32_t>(getBe(raw, 4));
+    pos.id = static_cast<int64_t>(getBe(raw + 4, 8));
+  } else if (len == kAmountRawLen && (raw[0] == 'A' || raw[0] == 'O') &&
+             raw[1] == 0) {
+    pos.key = raw[0] == 'A' ? Key::Amount : Key::Offset;
+    pos.value = static_cast<int64_t>(getBe(raw + 2, 8));
+    pos.id = static_cast<int64_t>(getBe(raw + 10, 8));
+  } else {
+    return std::nullopt;
+  }
+  if (pos.id <= 0 || (pos.key == Key::Offset && pos.value <= 0)) return std::nullopt;
+  return pos;
+}
+
+}  // namespace Cursor
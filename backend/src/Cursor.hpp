@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+
+// Opaque keyset-pagination cursors for GET /transactions. A cursor is the
+// sort key and id of the last row on a page, packed into bytes and
+// base64url-encoded; the next page starts strictly after that key.
+// Relevance ranks are not a stable key, so ranked search pages by offset.
+namespace Cursor {
+
+enum class Key : uint8_t {
+  Date,    // (tx_date, id); the original 12-byte, 16-character form
+  Amount,  // (amount, id)
+  Offset,  // row offset into a relevance-ranked search (?q=)
+};
+
+struct Position {
+  Key key = Key::Date;
+  int64_t value = 0;  // Date: days since 2000-01-01; Amount: cents;
+                      // Offset: rows already returned
+  int64_t id = 0;
+};
+
+std::string encode(const Position& pos);
+
+// Returns nullopt for anything that is not a cursor we issued.
+std::optional<Position> decode(const std::string& token);
+
+}  // namespace Cursor
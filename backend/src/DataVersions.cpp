@@ -0,0 +1,75 @@
+#include "DataVersions.hpp"
+
+#include <chrono>
+#include <cstdio>
+
+namespace {
+
+// FNV-1a; only has to tell request variants apart, not resist attackers
+// (a collision needs the same user, version and a second query string).
+uint64_t fnv1a(std::string_view s) {
+  uint64_t h = 1469598103934665603ull;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 1099511628211ull;
+  }
+  return h;
+}
+
+std::string_view trim(std::string_view s) {
+  while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+  while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+  return s;
+}
+
+std::string_view stripWeak(std::string_view tag) {
+  if (tag.size() >= 2 && tag[0] == 'W' && tag[1] == '/') tag.remove_prefix(2);
+  return tag;
+}
+
+}  // namespace
+
+DataVersions::DataVersions(size_t slots)
+    : m_epoch(static_cast<uint64_t>(
+          std::chrono::system_clock::now().time_since_epoch().count())),
+      m_slots(slots ? slots : 1),
+      m_versions(new std::atomic<uint64_t>[m_slots]) {
+  for (size_t i = 0; i < m_slots; i++) {
+    m_versions[i].store(0, std::memory_order_relaxed);
+  }
+}
+
+std::atomic<uint64_t>& DataVersions::slot(long userId) const {
+  return m_versions[static_cast<uint64_t>(userId) % m_slots];
+}
+
+void DataVersions::bump(long userId) {
+  slot(userId).fetch_add(1, std::memory_order_release);
+}
+
+std::string DataVersions::etag(long userId, std::string_view variant) const {
+  const uint64_t version = slot(userId).load(std::memory_order_acquire);
+  // The user id is part of the tag: versions start at 0 and slots are
+  // shared, so without it two users could be handed the same tag for the
+  // same URL and a browser switching accounts would get A's 304 for B.
+  char buf[96];
+  const int n = std::snprintf(buf, sizeof(buf), "\"%llx-%lx-%llx-%llx\"",
+                              static_cast<unsigned long long>(m_epoch),
+                              static_cast<unsigned long>(userId),
+                              static_cast<unsigned long long>(version),
+                              static_cast<unsigned long long>(fnv1a(variant)));
+  return std::string(buf, static_cast<size_t>(n));
+}
+
+bool DataVersions::matches(std::string_view ifNoneMatch, std::string_view etag) {
+  ifNoneMatch = trim(ifNoneMatch);
+  if (ifNoneMatch == "*") return true;
+  etag = stripWeak(etag);
+  while (!ifNoneMatch.empty()) {
+    const size_t comma = ifNoneMatch.find(',');
+    if (stripWeak(trim(ifNoneMatch.substr(0, comma))) == etag) return true;
+    if (comma == std::string_view::npos) break;
+    ifNoneMatch.remove_prefix(comma + 1);
+  }
+  return false;
+}
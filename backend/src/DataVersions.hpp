@@ -0,0 +1,41 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+
+// Per-user data version for conditional GETs. Every handler that changes
+// a user's rows bumps it once the change is committed; read endpoints put
+// it in their ETag, so a poll whose If-None-Match still matches is
+// answered 304 without touching the database.
+//
+// Versions live in a fixed table of counters indexed by user id: two
+// users sharing a slot only invalidate each other's tags more often. The
+// table starts from a per-process epoch, so tags issued before a restart
+// never match. Versions are per process; with several instances behind a
+// balancer a write on one is not seen by the others' tags.
+class DataVersions {
+ public:
+  explicit DataVersions(size_t slots = 65536);
+
+  void bump(long userId);
+
+  // Strong ETag (quoted) for `userId`'s current data (the id is part of
+  // the tag, so it never matches another user's), as rendered for the
+  // request `variant` (path plus query string, and anything else the
+  // body depends on).
+  std::string etag(long userId, std::string_view variant) const;
+
+  // If-None-Match semantics: "*" or any listed tag equal to `etag`
+  // (weak comparison, as RFC 9110 specifies for this header).
+  static bool matches(std::string_view ifNoneMatch, std::string_view etag);
+
+ private:
+  std::atomic<uint64_t>& slot(long userId) const;
+
+  const uint64_t m_epoch;
+  const size_t m_slots;
+  std::unique_ptr<std::atomic<uint64_t>[]> m_versions;
+};
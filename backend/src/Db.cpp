@@ -1,5 +1,6 @@
 #include "Db.hpp"
 
+#include <cstring>
 #include <stdexcept>
 #include <string>
 
@@ -7,6 +8,7 @@ Db::Db(const std::string& connStr) {
   m_conn = PQconnectdb(connStr.c_str());
   if (!m_conn || PQstatus(m_conn) != CONNECTION_OK) {
     std::string err = m_conn ? PQerrorMessage(m_conn) : "null connection";
+    if (m_conn) PQfinish(m_conn);
     throw std::runtime_error("DB connect failed: " + err);
   }
 }
@@ -27,3 +29,34 @@ void Db::execOrThrow(const std::string& sql) {
   }
   PQclear(r);
 }
+
+bool Db::ok() const {
+  return m_conn && PQstatus(m_conn) == CONNECTION_OK;
+}
+
+bool Db::reset() {
+  m_prepared.clear();
+  PQreset(m_conn);
+  return ok();
+}
+
+bool Db::prepare(const std::string& name, const std::string& sql,
+                 int nParams) {
+  if (m_prepared.count(name)) return true;
+
+  PGresult* r = PQprepare(m_conn, name.c_str(), sql.c_str(), nParams, nullptr);
+  bool good = r && PQresultStatus(r) == PGRES_COMMAND_OK;
+  if (!good && r) {
+    // 42P05 duplicate_prepared_statement: the server still has it even
+    // though our cache was cleared.
+    const char* state = PQresultErrorField(r, PG_DIAG_SQLSTATE);
+    good = state && std::strcmp(state, "42P05") == 0;
+  }
+  if (r) PQclear(r);
+  if (good) m_prepared.insert(name);
+  return good;
+}
+
+bool Db::isPrepared(const std::string& name) const {
+  return m_prepared.count(name) != 0;
+}
@@ -1,5 +1,6 @@
 #pragma once
 #include <string>
+#include <unordered_set>
 
 #include <libpq-fe.h>
 
@@ -15,6 +16,22 @@ class Db {
 
   void execOrThrow(const std::string& sql);
 
+  // Connection health (PQstatus) and in-place reconnect via PQreset.
+  // A reset drops every server-side prepared statement, so the statement
+  // cache is cleared with it.
+  bool ok() const;
+  bool reset();
+
+  // Per-connection statement cache: PQprepare `name` once, later calls are
+  // a set lookup. Returns false if the server rejected the statement.
+  bool prepare(const std::string& name, const std::string& sql, int nParams);
+  bool isPrepared(const std::string& name) const;
+  // Records a statement prepared by other means (e.g. a pipelined
+  // PQsendPrepare whose result has come back).
+  void markPrepared(const std::string& name) { m_prepared.insert(name); }
+  void forgetPrepared() { m_prepared.clear(); }
+
  private:
   PGconn* m_conn = nullptr;
+  std::unordered_set<std::string> m_prepared;
 };
@@ -0,0 +1,154 @@
+#include "DbPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+static DbPoolOptions normalize(DbPoolOptions o) {
+  o.maxSize = std::max(o.maxSize, 1);
+  o.minSize = std::clamp(o.minSize, 0, o.maxSize);
+  o.checkoutTimeoutMs = std::max(o.checkoutTimeoutMs, 0);
+  return o;
+}
+
+static uint64_t microsSince(std::chrono::steady_clock::time_point t0) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(
+          std::chrono::steady_clock::now() - t0)
+          .count());
+}
+
+DbPool::Lease::~Lease() {
+  if (m_pool && m_db) m_pool->release(std::move(m_db));
+}
+
+DbPool::Lease& DbPool::Lease::operator=(Lease&& o) noexcept {
+  if (this != &o) {
+    if (m_pool && m_db) m_pool->release(std::move(m_db));
+    m_pool = o.m_pool;
+    m_db = std::move(o.m_db);
+  }
+  return *this;
+}
+
+DbPool::DbPool(std::string connStr, DbPoolOptions opts,
+               std::function<void(Db&)> onConnect)
+    : m_connStr(std::move(connStr)),
+      m_opts(normalize(opts)),
+      m_onConnect(std::move(onConnect)) {
+  // Open the minimum eagerly so a bad DATABASE_URL fails at startup.
+  for (int i = 0; i < m_opts.minSize; i++) {
+    auto db = std::make_unique<Db>(m_connStr);
+    if (m_onConnect) m_onConnect(*db);
+    m_idle.push_back(std::move(db));
+    m_size++;
+  }
+}
+
+std::unique_ptr<Db> DbPool::connect() {
+  try {
+    auto db = std::make_unique<Db>(m_connStr);
+    if (m_onConnect) m_onConnect(*db);
+    return db;
+  } catch (const std::exception&) {
+    m_connectFailures.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+}
+
+DbPool::Lease DbPool::acquire() {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  const auto t0 = std::chrono::steady_clock::now();
+  const auto deadline = t0 + std::chrono::milliseconds(m_opts.checkoutTimeoutMs);
+
+  std::unique_lock<std::mutex> lock(m_mu);
+  for (;;) {
+    if (!m_idle.empty()) {
+      std::unique_ptr<Db> db = std::move(m_idle.back());
+      m_idle.pop_back();
+      lock.unlock();
+
+      // Health check outside the lock; a dead socket gets one PQreset
+      // before the slot is given up.
+      if (!db->ok()) {
+        m_resets.fetch_add(1, std::memory_order_relaxed);
+        if (!db->reset()) {
+          db.reset();
+          lock.lock();
+          m_size--;
+          m_cv.notify_one();
+          continue;
+        }
+        if (m_onConnect) m_onConnect(*db);
+      }
+
+      m_checkouts.fetch_add(1, std::memory_order_relaxed);
+      m_wait.record(microsSince(t0));
+      return Lease(this, std::move(db));
+    }
+
+    if (m_size < m_opts.maxSize) {
+      m_size++;
+      lock.unlock();
+
+      std::unique_ptr<Db> db = connect();
+      if (!db) {
+        lock.lock();
+        m_size--;
+        m_cv.notify_one();
+        return Lease();
+      }
+
+      m_checkouts.fetch_add(1, std::memory_order_relaxed);
+      m_wait.record(microsSince(t0));
+      return Lease(this, std::move(db));
+    }
+
+    m_waiters++;
+    const bool signalled = m_cv.wait_until(lock, deadline, [this] {
+      return !m_idle.empty() || m_size < m_opts.maxSize;
+    });
+    m_waiters--;
+
+    if (!signalled) {
+      m_timeouts.fetch_add(1, std::memory_order_relaxed);
+      m_wait.record(microsSince(t0));
+      return Lease();
+    }
+  }
+}
+
+void DbPool::release(std::unique_ptr<Db> db) {
+  // Never hand an open transaction to the next request.
+  PGTransactionStatusType ts = PQtransactionStatus(db->conn());
+  if (ts == PQTRANS_INTRANS || ts == PQTRANS_INERROR) {
+    PGresult* r = PQexec(db->conn(), "ROLLBACK");
+    if (r) PQclear(r);
+  } else if (ts == PQTRANS_ACTIVE) {
+    // A command is still in flight (e.g. an abandoned async query);
+    // reconnecting is the only safe way to reuse this connection.
+    m_resets.fetch_add(1, std::memory_order_relaxed);
+    if (db->reset() && m_onConnect) m_onConnect(*db);
+  }
+
+  std::lock_guard<std::mutex> lock(m_mu);
+  m_idle.push_back(std::move(db));
+  m_cv.notify_one();
+}
+
+DbPool::Stats DbPool::stats() const {
+  Stats s;
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    s.size = m_size;
+    s.idle = static_cast<int>(m_idle.size());
+    s.waiters = m_waiters;
+  }
+  s.inUse = s.size - s.idle;
+  s.maxSize = m_opts.maxSize;
+  s.checkouts = m_checkouts.load(std::memory_order_relaxed);
+  s.timeouts = m_timeouts.load(std::memory_order_relaxed);
+  s.resets = m_resets.load(std::memory_order_relaxed);
+  s.connectFailures = m_connectFailures.load(std::memory_order_relaxed);
+  return s;
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Db.hpp"
+#include "Metrics.hpp"
+
+struct DbPoolOptions {
+  int minSize = 2;
+  int maxSize = 8;
+  int checkoutTimeoutMs = 5000;
+};
+
+// Fixed-bound pool of Db connections shared by the httplib worker threads.
+// Connections are health-checked (PQstatus, then PQreset) on checkout, and
+// each keeps its own prepared-statement cache for its whole lifetime.
+class DbPool {
+ public:
+  // RAII checkout: returns the connection to the pool when destroyed.
+  // An empty lease means the checkout timed out or no connection could
+  // be opened.
+  class Lease {
+   public:
+    Lease() = default;
+    Lease(DbPool* pool, std::unique_ptr<Db> db)
+        : m_pool(pool), m_db(std::move(db)) {}
+    ~Lease();
+
+    Lease(Lease&& o) noexcept = default;
+    Lease& operator=(Lease&& o) noexcept;
+    Lease(const Lease&) = delete;
+    Lease& operator=(const Lease&) = delete;
+
+    explicit operator bool() const { return m_db != nullptr; }
+    Db* operator->() const { return m_db.get(); }
+    Db& operator*() const { return *m_db; }
+
+   private:
+    DbPool* m_pool = nullptr;
+    std::unique_ptr<Db> m_db;
+  };
+
+  struct Stats {
+    int size = 0;
+    int idle = 0;
+    int inUse = 0;
+    int waiters = 0;
+    int maxSize = 0;
+    uint64_t checkouts = 0;
+    uint64_t timeouts = 0;
+    uint64_t resets = 0;
+    uint64_t connectFailures = 0;
+  };
+
+  // `onConnect` runs on every fresh or reset connection before it is
+  // handed out (e.g. to prepare statements).
+  DbPool(std::string connStr, DbPoolOptions opts,
+         std::function<void(Db&)> onConnect = nullptr);
+
+  DbPool(const DbPool&) = delete;
+  DbPool& operator=(const DbPool&) = delete;
+
+  Lease acquire();
+
+  Stats stats() const;
+  const Metrics::LatencyHistogram& waitHistogram() const { return m_wait; }
+
+ private:
+  void release(std::unique_ptr<Db> db);
+  std::unique_ptr<Db> connect();
+
+  const std::string m_connStr;
+  const DbPoolOptions m_opts;
+  const std::function<void(Db&)> m_onConnect;
+
+  mutable std::mutex m_mu;
+  std::condition_variable m_cv;
+  std::vector<std::unique_ptr<Db>> m_idle;
+  int m_size = 0;  // open connections, idle + leased + being opened
+  int m_waiters = 0;
+
+  std::atomic<uint64_t> m_checkouts{0};
+  std::atomic<uint64_t> m_timeouts{0};
+  std::atomic<uint64_t> m_resets{0};
+  std::atomic<uint64_t> m_connectFailures{0};
+  Metrics::LatencyHistogram m_wait;
+};
@@ -0,0 +1,35 @@
+#include "Gzip.hpp"
+
+#include <stdexcept>
+
+GzipStream::GzipStream(int level) {
+  // windowBits 15 + 16 selects the gzip wrapper instead of raw zlib.
+  if (deflateInit2(&m_z, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    throw std::runtime_error("deflateInit2 failed");
+  }
+}
+
+GzipStream::~GzipStream() { deflateEnd(&m_z); }
+
+void GzipStream::write(std::string_view in, std::string& out) {
+  if (!in.empty()) deflateInto(in, Z_NO_FLUSH, out);
+}
+
+void GzipStream::finish(std::string& out) { deflateInto({}, Z_FINISH, out); }
+
+void GzipStream::reset() {
+  if (deflateReset(&m_z) != Z_OK) throw std::runtime_error("deflateReset failed");
+}
+
+void GzipStream::deflateInto(std::string_view in, int flush, std::string& out) {
+  m_z.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in.data()));
+  m_z.avail_in = static_cast<uInt>(in.size());
+  char buf[16384];
+  do {
+    m_z.next_out = reinterpret_cast<Bytef*>(buf);
+    m_z.avail_out = sizeof(buf);
+    const int rc = deflate(&m_z, flush);
+    if (rc == Z_STREAM_ERROR) throw std::runtime_error("deflate failed");
+    out.append(buf, sizeof(buf) - m_z.avail_out);
+  } while (m_z.avail_out == 0);
+}
@@ -0,0 +1,32 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+#include <zlib.h>
+
+// Incremental gzip (RFC 1952) encoder over zlib's deflate, for response
+// bodies that are produced a piece at a time. Output is appended to the
+// caller's buffer; nothing is buffered here beyond deflate's own window.
+class GzipStream {
+ public:
+  explicit GzipStream(int level = 6);
+  ~GzipStream();
+
+  GzipStream(const GzipStream&) = delete;
+  GzipStream& operator=(const GzipStream&) = delete;
+
+  // Compresses `in`, appending whatever deflate emits (possibly nothing).
+  void write(std::string_view in, std::string& out);
+
+  // Flushes the rest of the stream and the gzip trailer.
+  void finish(std::string& out);
+
+  // Starts a new gzip member, keeping deflate's allocated state, so one
+  // stream can encode many bodies in turn.
+  void reset();
+
+ private:
+  void deflateInto(std::string_view in, int flush, std::string& out);
+
+  z_stream m_z{};
+};
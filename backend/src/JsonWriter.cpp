@@ -0,0 +1,115 @@
+#include "JsonWriter.hpp"
+
+#include "Utils/Money.hpp"
+
+#include <charconv>
+
+JsonWriter& JsonWriter::beginObject() {
+  separate();
+  m_out += '{';
+  m_needComma = false;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endObject() {
+  m_out += '}';
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginArray() {
+  separate();
+  m_out += '[';
+  m_needComma = false;
+  return *this;
+}
+
+JsonWriter& JsonWriter::endArray() {
+  m_out += ']';
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view k) {
+  separate();
+  escaped(k);
+  m_out += ':';
+  m_needComma = false;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view s) {
+  separate();
+  escaped(s);
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t n) {
+  separate();
+  char buf[24];
+  m_out.append(buf, std::to_chars(buf, buf + sizeof(buf), n).ptr);
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+  separate();
+  m_out += b ? "true" : "false";
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::null() {
+  separate();
+  m_out += "null";
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::cents(int64_t c) {
+  separate();
+  utils::appendCents(m_out, c);
+  m_needComma = true;
+  return *this;
+}
+
+JsonWriter& JsonWriter::raw(std::string_view json) {
+  separate();
+  m_out += json;
+  m_needComma = true;
+  return *this;
+}
+
+void JsonWriter::separate() {
+  if (m_needComma) m_out += ',';
+}
+
+// Copies runs of safe bytes in one append; only quotes, backslashes and
+// control characters are rewritten. UTF-8 passes through untouched.
+void JsonWriter::escaped(std::string_view s) {
+  static const char kHex[] = "0123456789abcdef";
+  m_out += '"';
+  size_t run = 0;
+  for (size_t i = 0; i < s.size(); i++) {
+    const unsigned char c = static_cast<unsigned char>(s[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') continue;
+    m_out.append(s.data() + run, i - run);
+    run = i + 1;
+    switch (c) {
+      case '"': m_out += "\\\""; break;
+      case '\\': m_out += "\\\\"; break;
+      case '\n': m_out += "\\n"; break;
+      case '\r': m_out += "\\r"; break;
+      case '\t': m_out += "\\t"; break;
+      case '\b': m_out += "\\b"; break;
+      case '\f': m_out += "\\f"; break;
+      default: {
+        const char u[] = {'\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF]};
+        m_out.append(u, sizeof(u));
+      }
+    }
+  }
+  m_out.append(s.data() + run, s.size() - run);
+  m_out += '"';
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Forward-only JSON serializer that appends straight into a caller-owned
+// buffer, for responses too large or too hot to build as a json DOM first.
+// Strings are escaped in place; the caller is responsible for pairing
+// begin/end calls and for putting a key before every value in an object.
+// The buffer may be flushed and cleared between values (e.g. into a
+// chunked response) without disturbing the writer's state.
+class JsonWriter {
+ public:
+  explicit JsonWriter(std::string& out) : m_out(out) {}
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+
+  JsonWriter& key(std::string_view k);
+
+  JsonWriter& value(std::string_view s);
+  JsonWriter& value(const char* s) { return value(std::string_view(s)); }
+  JsonWriter& value(int64_t n);
+  JsonWriter& value(bool b);
+  JsonWriter& null();
+
+  // Integer cents as an exact decimal amount, e.g. -1999 -> -19.99.
+  JsonWriter& cents(int64_t c);
+
+  // Pastes an already serialized JSON value.
+  JsonWriter& raw(std::string_view json);
+
+ private:
+  void separate();
+  void escaped(std::string_view s);
+
+  std::string& m_out;
+  bool m_needComma = false;
+};
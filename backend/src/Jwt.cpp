@@ -1,12 +1,17 @@
 #include "Jwt.hpp"
 
 #include "nlohmann/json.hpp"
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
 #include <openssl/evp.h>
 #include <openssl/hmac.h>
+#include <openssl/params.h>
 
+#include <cstdint>
 #include <ctime>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <vector>
 
 using json = nlohmann::json;
@@ -28,30 +33,6 @@ static std::string b64UrlEncode(const std::string& in) {
   return out;
 }
 
-static std::string b64UrlDecodeToString(const std::string& in) {
-  std::string b64 = in;
-
-  for (char& c : b64) {
-    if (c == '-') c = '+';
-    else if (c == '_') c = '/';
-  }
-  while (b64.size() % 4 != 0) b64.push_back('=');
-
-  std::vector<unsigned char> out((b64.size() * 3) / 4);
-
-  int n = EVP_DecodeBlock(out.data(),
-                          reinterpret_cast<const unsigned char*>(b64.data()),
-                          static_cast<int>(b64.size()));
-  if (n < 0) return "";
-
-  int pad = 0;
-  if (!b64.empty() && b64[b64.size() - 1] == '=') pad++;
-  if (b64.size() > 1 && b64[b64.size() - 2] == '=') pad++;
-
-  out.resize(static_cast<size_t>(n - pad));
-  return std::string(out.begin(), out.end());
-}
-
 static std::string hmacSha256(const std::string& data,
                               const std::string& secret) {
   unsigned int len = 0;
@@ -66,13 +47,233 @@ static std::string hmacSha256(const std::string& data,
   return std::string(reinterpret_cast<char*>(out), len);
 }
 
-static bool constantTimeEq(const std::string& a, const std::string& b) {
-  if (a.size() != b.size()) return false;
-  unsigned char diff = 0;
-  for (size_t i = 0; i < a.size(); i++) diff |= (a[i] ^ b[i]);
-  return diff == 0;
+// ---- verification: string_view based, no heap allocation ----
+
+// base64url alphabet -> 6-bit value, 0xFF for anything else.
+static const unsigned char* b64UrlTable() {
+  static const auto table = [] {
+    static unsigned char t[256];
+    for (auto& v : t) v = 0xFF;
+    const char* alpha =
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789-_";
+    for (unsigned char i = 0; i < 64; i++) {
+      t[static_cast<unsigned char>(alpha[i])] = i;
+    }
+    return t;
+  }();
+  return table;
+}
+
+// Decodes unpadded base64url into `out`; returns the byte count, or -1 on
+// a bad character, an impossible length or output larger than `cap`.
+static int b64UrlDecodeInto(std::string_view in, unsigned char* out,
+                            size_t cap) {
+  if (in.size() % 4 == 1) return -1;
+  const size_t outLen = in.size() / 4 * 3 + (in.size() % 4 ? in.size() % 4 - 1 : 0);
+  if (outLen > cap) return -1;
+
+  const unsigned char* t = b64UrlTable();
+  uint32_t acc = 0;
+  int bits = 0;
+  size_t n = 0;
+  for (char c : in) {
+    const unsigned char v = t[static_cast<unsigned char>(c)];
+    if (v == 0xFF) return -1;
+    acc = (acc << 6) | v;
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      out[n++] = static_cast<unsigned char>(acc >> bits);
+    }
+  }
+  // Leftover bits must be zero, so each byte string has exactly one
+  // accepted encoding (no malleable signatures).
+  if (acc & ((1u << bits) - 1)) return -1;
+  return static_cast<int>(n);
 }
 
+// One HMAC-SHA256 context per thread, keyed once with the secret; each
+// verification re-initialises it with the same key instead of setting up
+// a fresh context.
+class ThreadMac {
+ public:
+  ~ThreadMac() {
+    EVP_MAC_CTX_free(m_ctx);
+    EVP_MAC_free(m_mac);
+  }
+
+  bool sha256(const std::string& secret, std::string_view data,
+              unsigned char out[32]) {
+    if (!m_ctx || secret != m_key) {
+      if (!rekey(secret)) return false;
+    } else if (!EVP_MAC_init(m_ctx, nullptr, 0, nullptr)) {
+      return false;
+    }
+
+    size_t len = 0;
+    return EVP_MAC_update(m_ctx,
+                          reinterpret_cast<const unsigned char*>(data.data()),
+                          data.size()) &&
+           EVP_MAC_final(m_ctx, out, &len, 32) && len == 32;
+  }
+
+ private:
+  bool rekey(const std::string& secret) {
+    if (!m_mac) m_mac = EVP_MAC_fetch(nullptr, "HMAC", nullptr);
+    if (!m_mac) return false;
+    EVP_MAC_CTX_free(m_ctx);
+    m_ctx = EVP_MAC_CTX_new(m_mac);
+    if (!m_ctx) return false;
+
+    char digest[] = "SHA256";
+    OSSL_PARAM params[] = {
+        OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, digest, 0),
+        OSSL_PARAM_construct_end(),
+    };
+    if (!EVP_MAC_init(m_ctx,
+                      reinterpret_cast<const unsigned char*>(secret.data()),
+                      secret.size(), params)) {
+      EVP_MAC_CTX_free(m_ctx);
+      m_ctx = nullptr;
+      return false;
+    }
+    m_key = secret;
+    return true;
+  }
+
+  EVP_MAC* m_mac = nullptr;
+  EVP_MAC_CTX* m_ctx = nullptr;
+  std::string m_key;
+};
+
+// Minimal scanner for the JWT payload object: pulls out "sub" (string or
+// integer) and "exp" (integer) and skips every other member, instead of
+// building a json DOM for two claims.
+class ClaimScanner {
+ public:
+  explicit ClaimScanner(std::string_view s) : m_s(s) {}
+
+  bool scan(long& sub, bool& hasSub, long& exp, bool& hasExp) {
+    ws();
+    if (!eat('{')) return false;
+    ws();
+    if (eat('}')) return true;
+    for (;;) {
+      std::string_view key;
+      if (!str(key)) return false;
+      ws();
+      if (!eat(':')) return false;
+      ws();
+      if (key == "sub") {
+        std::string_view digits;
+        if (peek() == '"') {
+          if (!str(digits) || !toLong(digits, sub)) return false;
+        } else if (!integer(sub)) {
+          return false;
+        }
+        hasSub = true;
+      } else if (key == "exp") {
+        if (!integer(exp)) return false;
+        hasExp = true;
+      } else if (!skipValue(0)) {
+        return false;
+      }
+      ws();
+      if (eat('}')) return true;
+      if (!eat(',')) return false;
+      ws();
+    }
+  }
+
+ private:
+  char peek() const { return m_i < m_s.size() ? m_s[m_i] : '\0'; }
+  bool eat(char c) {
+    if (peek() != c) return false;
+    m_i++;
+    return true;
+  }
+  void ws() {
+    while (m_i < m_s.size() && (m_s[m_i] == ' ' || m_s[m_i] == '\t' ||
+                                m_s[m_i] == '\n' || m_s[m_i] == '\r')) {
+      m_i++;
+    }
+  }
+
+  // String body without the quotes; escapes are skipped, not decoded.
+  bool str(std::string_view& out) {
+    if (!eat('"')) return false;
+    const size_t start = m_i;
+    while (m_i < m_s.size() && m_s[m_i] != '"') {
+      if (m_s[m_i] == '\\') m_i++;
+      m_i++;
+    }
+    if (m_i >= m_s.size()) return false;
+    out = m_s.substr(start, m_i - start);
+    m_i++;
+    return true;
+  }
+
+  static bool toLong(std::string_view d, long& out) {
+    if (d.empty() || d.size() > 18) return false;
+    long v = 0;
+    for (char c : d) {
+      if (c < '0' || c > '9') return false;
+      v = v * 10 + (c - '0');
+    }
+    out = v;
+    return true;
+  }
+
+  bool integer(long& out) {
+    const bool neg = eat('-');
+    const size_t start = m_i;
+    while (m_i < m_s.size() && m_s[m_i] >= '0' && m_s[m_i] <= '9') m_i++;
+    if (!toLong(m_s.substr(start, m_i - start), out)) return false;
+    if (neg) out = -out;
+    return true;
+  }
+
+  bool skipValue(int depth) {
+    if (depth > 16) return false;
+    const char c = peek();
+    if (c == '"') {
+      std::string_view ignored;
+      return str(ignored);
+    }
+    if (c == '{' || c == '[') {
+      const char close = c == '{' ? '}' : ']';
+      m_i++;
+      ws();
+      if (eat(close)) return true;
+      for (;;) {
+        if (c == '{') {
+          std::string_view ignored;
+          if (!str(ignored)) return false;
+          ws();
+          if (!eat(':')) return false;
+          ws();
+        }
+        if (!skipValue(depth + 1)) return false;
+        ws();
+        if (eat(close)) return true;
+        if (!eat(',')) return false;
+        ws();
+      }
+    }
+    // number, true, false, null
+    const size_t start = m_i;
+    while (m_i < m_s.size() && m_s[m_i] != ',' && m_s[m_i] != '}' &&
+           m_s[m_i] != ']' && m_s[m_i] != ' ' && m_s[m_i] != '\n' &&
+           m_s[m_i] != '\r' && m_s[m_i] != '\t') {
+      m_i++;
+    }
+    return m_i > start;
+  }
+
+  std::string_view m_s;
+  size_t m_i = 0;
+};
+
 std::string Jwt::signUser(long userId, const std::string& secret,
                           int ttlSeconds) {
   json header = {{"alg", "HS256"}, {"typ", "JWT"}};
@@ -94,51 +295,44 @@ std::string Jwt::signUser(long userId, const std::string& secret,
   return signingInput + "." + sig;
 }
 
-std::optional<long> Jwt::verifyAndGetUserId(const std::string& token,
-                                            const std::string& secret) {
-  size_t a = token.find('.');
-  if (a == std::string::npos) return std::nullopt;
-  size_t b = token.find('.', a + 1);
-  if (b == std::string::npos) return std::nullopt;
-
-  std::string h = token.substr(0, a);
-  std::string p = token.substr(a + 1, b - (a + 1));
-  std::string s = token.substr(b + 1);
-
-  std::string signingInput = h + "." + p;
-  std::string expectedRaw = hmacSha256(signingInput, secret);
-  std::string expected = b64UrlEncode(expectedRaw);
-
-  if (!constantTimeEq(expected, s)) return std::nullopt;
-
-  std::string payloadJson = b64UrlDecodeToString(p);
-  if (payloadJson.empty()) return std::nullopt;
+std::optional<Jwt::Claims> Jwt::verify(std::string_view token,
+                                       const std::string& secret) {
+  const size_t a = token.find('.');
+  if (a == std::string_view::npos) return std::nullopt;
+  const size_t b = token.find('.', a + 1);
+  if (b == std::string_view::npos) return std::nullopt;
 
-  json payload = json::parse(payloadJson, nullptr, false);
-  if (payload.is_discarded()) return std::nullopt;
-
-  if (!payload.contains("exp") || !payload.contains("sub")) return std::nullopt;
-
-  long exp = 0;
-  try {
-    exp = payload["exp"].get<long>();
-  } catch (...) {
+  // HS256 signatures are 32 bytes; decode once and compare raw bytes.
+  unsigned char sig[32];
+  if (b64UrlDecodeInto(token.substr(b + 1), sig, sizeof(sig)) != 32) {
     return std::nullopt;
   }
 
-  std::time_t now = std::time(nullptr);
-  if (now >= exp) return std::nullopt;
-
-  std::string sub;
-  try {
-    sub = payload["sub"].get<std::string>();
-  } catch (...) {
+  static thread_local ThreadMac mac;
+  unsigned char expected[32];
+  if (!mac.sha256(secret, token.substr(0, b), expected)) return std::nullopt;
+  if (CRYPTO_memcmp(sig, expected, sizeof(sig)) != 0) return std::nullopt;
+
+  unsigned char payload[1024];
+  const int n = b64UrlDecodeInto(token.substr(a + 1, b - (a + 1)), payload,
+                                 sizeof(payload));
+  if (n <= 0) return std::nullopt;
+
+  long sub = 0, exp = 0;
+  bool hasSub = false, hasExp = false;
+  ClaimScanner scanner(
+      std::string_view(reinterpret_cast<const char*>(payload), static_cast<size_t>(n)));
+  if (!scanner.scan(sub, hasSub, exp, hasExp) || !hasSub || !hasExp) {
     return std::nullopt;
   }
 
-  try {
-    return std::stol(sub);
-  } catch (...) {
-    return std::nullopt;
-  }
+  if (std::time(nullptr) >= exp) return std::nullopt;
+  return Claims{sub, exp};
+}
+
+std::optional<long> Jwt::verifyAndGetUserId(std::string_view token,
+                                            const std::string& secret) {
+  auto claims = verify(token, secret);
+  if (!claims) return std::nullopt;
+  return claims->userId;
 }
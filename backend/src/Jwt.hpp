@@ -1,12 +1,23 @@
 #pragma once
 #include <optional>
 #include <string>
+#include <string_view>
 
 namespace Jwt {
   // Create a JWT for a given userId, with ttlSeconds expiry (HS256)
   std::string signUser(long userId, const std::string& secret, int ttlSeconds);
 
+  struct Claims {
+    long userId = 0;
+    long exp = 0;  // unix seconds
+  };
+
+  // Verify token signature + exp and return its claims if valid.
+  // Allocation-free: works on views into `token` and stack buffers.
+  std::optional<Claims> verify(std::string_view token,
+                               const std::string& secret);
+
   // Verify token signature + exp and return userId if valid
-  std::optional<long> verifyAndGetUserId(const std::string& token,
+  std::optional<long> verifyAndGetUserId(std::string_view token,
                                         const std::string& secret);
 }
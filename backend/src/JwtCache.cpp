@@ -0,0 +1,29 @@
+#include "JwtCache.hpp"
+
+#include <openssl/evp.h>
+
+#include <ctime>
+
+JwtCache::Digest JwtCache::digest(std::string_view token) {
+  Digest d{};
+  unsigned int len = 0;
+  EVP_Digest(token.data(), token.size(), d.data(), &len, EVP_sha256(),
+             nullptr);
+  return d;
+}
+
+std::optional<long> JwtCache::lookup(std::string_view token) {
+  const Digest key = digest(token);
+  auto claims = m_lru.get(key);
+  if (!claims) return std::nullopt;
+
+  if (std::time(nullptr) >= claims->exp) {
+    m_lru.erase(key);
+    return std::nullopt;
+  }
+  return claims->userId;
+}
+
+void JwtCache::remember(std::string_view token, const Jwt::Claims& claims) {
+  m_lru.put(digest(token), claims);
+}
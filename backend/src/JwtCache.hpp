@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "Jwt.hpp"
+#include "LruCache.hpp"
+
+// Remembers tokens that already passed Jwt::verify, so a client reusing
+// its bearer token skips HMAC and payload parsing on every request.
+// Entries are keyed by the token's SHA-256 (never the token itself) and
+// stop matching once the token's exp has passed. Only successful
+// verifications are cached.
+class JwtCache {
+ public:
+  explicit JwtCache(size_t capacity) : m_lru(capacity) {}
+
+  // userId for a cached, unexpired token.
+  std::optional<long> lookup(std::string_view token);
+  void remember(std::string_view token, const Jwt::Claims& claims);
+
+  uint64_t hits() const { return m_lru.hits(); }
+  uint64_t misses() const { return m_lru.misses(); }
+  uint64_t evictions() const { return m_lru.evictions(); }
+  size_t size() const { return m_lru.size(); }
+
+ private:
+  using Digest = std::array<unsigned char, 32>;
+
+  struct DigestHash {
+    size_t operator()(const Digest& d) const {
+      size_t h;
+      std::memcpy(&h, d.data(), sizeof(h));  // already uniformly random
+      return h;
+    }
+  };
+
+  static Digest digest(std::string_view token);
+
+  ShardedLru<Digest, Jwt::Claims, DigestHash> m_lru;
+};
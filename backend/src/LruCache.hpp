@@ -0,0 +1,131 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+// Every entry weighs 1, so capacity is an entry count.
+struct LruUnitWeight {
+  template <class K, class V>
+  size_t operator()(const K&, const V&) const { return 1; }
+};
+
+// Thread-safe LRU split into independently locked shards, so concurrent
+// httplib workers rarely contend. Capacity is a total weight (by default
+// an entry count) spread evenly over the shards; each shard evicts its
+// own least recently used until it is back under its share. An entry
+// heavier than a whole shard is not stored.
+template <class K, class V, class Hash = std::hash<K>, class Weigh = LruUnitWeight>
+class ShardedLru {
+ public:
+  explicit ShardedLru(size_t capacity, size_t shards = 16)
+      : m_shards(std::max<size_t>(shards, 1)) {
+    const size_t perShard = std::max<size_t>(capacity / m_shards.size(), 1);
+    for (auto& s : m_shards) s.capacity = perShard;
+  }
+
+  ShardedLru(const ShardedLru&) = delete;
+  ShardedLru& operator=(const ShardedLru&) = delete;
+
+  std::optional<V> get(const K& key) {
+    Shard& s = shardFor(key);
+    std::lock_guard<std::mutex> lock(s.mu);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) {
+      m_misses.fetch_add(1, std::memory_order_relaxed);
+      return std::nullopt;
+    }
+    s.order.splice(s.order.begin(), s.order, it->second);
+    m_hits.fetch_add(1, std::memory_order_relaxed);
+    return it->second->value;
+  }
+
+  void put(const K& key, V value) {
+    Shard& s = shardFor(key);
+    const size_t weight = m_weigh(key, value);
+    std::lock_guard<std::mutex> lock(s.mu);
+    auto it = s.index.find(key);
+    if (it != s.index.end()) {
+      s.used -= it->second->weight;
+      s.order.erase(it->second);
+      s.index.erase(it);
+    }
+    if (weight > s.capacity) return;
+    s.order.push_front({key, std::move(value), weight});
+    s.index.emplace(key, s.order.begin());
+    s.used += weight;
+    while (s.used > s.capacity) {
+      s.used -= s.order.back().weight;
+      s.index.erase(s.order.back().key);
+      s.order.pop_back();
+      m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+  }
+
+  void erase(const K& key) {
+    Shard& s = shardFor(key);
+    std::lock_guard<std::mutex> lock(s.mu);
+    auto it = s.index.find(key);
+    if (it == s.index.end()) return;
+    s.used -= it->second->weight;
+    s.order.erase(it->second);
+    s.index.erase(it);
+  }
+
+  size_t size() const {
+    size_t n = 0;
+    for (auto& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.mu);
+      n += s.index.size();
+    }
+    return n;
+  }
+
+  // Sum of entry weights currently stored.
+  size_t weight() const {
+    size_t n = 0;
+    for (auto& s : m_shards) {
+      std::lock_guard<std::mutex> lock(s.mu);
+      n += s.used;
+    }
+    return n;
+  }
+
+  uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+  uint64_t evictions() const { return m_evictions.load(std::memory_order_relaxed); }
+
+ private:
+  struct Entry {
+    K key;
+    V value;
+    size_t weight;
+  };
+
+  struct Shard {
+    mutable std::mutex mu;
+    std::list<Entry> order;  // front = most recently used
+    std::unordered_map<K, typename std::list<Entry>::iterator, Hash> index;
+    size_t capacity = 1;
+    size_t used = 0;
+  };
+
+  Shard& shardFor(const K& key) {
+    return m_shards[m_hash(key) % m_shards.size()];
+  }
+
+  Hash m_hash;
+  Weigh m_weigh;
+  std::vector<Shard> m_shards;
+  std::atomic<uint64_t> m_hits{0};
+  std::atomic<uint64_t> m_misses{0};
+  std::atomic<uint64_t> m_evictions{0};
+};
@@ -0,0 +1,355 @@
+#include "Metrics.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+
+namespace Metrics {
+
+namespace {
+
+// Single-writer increment: each shard is only written by its own thread,
+// so a relaxed load and store (a plain add) is enough, with no lock prefix.
+void bump(std::atomic<uint64_t>& a, uint64_t n = 1) {
+  a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+// The request being timed on this thread, if any.
+struct Active {
+  bool on = false;
+  std::array<uint64_t, kPhases> nanos{};
+  std::array<int, kPhases> depth{};
+  std::array<bool, kPhases> used{};
+};
+
+thread_local Active t_active;
+
+std::atomic<uint64_t> g_nextRegistryId{1};
+
+uint64_t micros(std::chrono::steady_clock::duration d) {
+  return static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+}
+
+void appendEscaped(std::string& out, std::string_view s) {
+  for (char c : s) {
+    if (c == '\\' || c == '"') out += '\\';
+    if (c == '\n') {
+      out += "\\n";
+      continue;
+    }
+    out += c;
+  }
+}
+
+void appendU64(std::string& out, uint64_t v) { out += std::to_string(v); }
+
+void appendSeconds(std::string& out, uint64_t micros) {
+  char buf[32];
+  const int n = std::snprintf(buf, sizeof(buf), "%.9g", static_cast<double>(micros) / 1e6);
+  out.append(buf, static_cast<size_t>(n));
+}
+
+void header(std::string& out, std::string_view name, std::string_view help,
+            std::string_view type) {
+  out += "# HELP ";
+  out += name;
+  out += ' ';
+  out += help;
+  out += "\n# TYPE ";
+  out += name;
+  out += ' ';
+  out += type;
+  out += '\n';
+}
+
+// Summed copy of one histogram across shards.
+struct HistogramTotals {
+  std::array<uint64_t, LatencyHistogram::kBuckets> buckets{};
+  uint64_t count = 0;
+  uint64_t sumMicros = 0;
+};
+
+}  // namespace
+
+// ---- LatencyHistogram ----
+
+void LatencyHistogram::record(uint64_t micros) {
+  m_buckets[bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+  m_count.fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(micros, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::upperBoundMicros(int i) {
+  if (i >= kBuckets - 1) return 0;
+  return uint64_t{1} << i;
+}
+
+int LatencyHistogram::bucketFor(uint64_t micros) {
+  if (micros <= 1) return 0;
+  // ceil(log2(micros)): the smallest i with micros <= 2^i.
+  const int i = 64 - __builtin_clzll(micros - 1);
+  return std::min(i, kBuckets - 1);
+}
+
+// ---- phases ----
+
+const char* phaseName(Phase p) {
+  switch (p) {
+    case Phase::Auth:
+      return "auth";
+    case Phase::Hash:
+      return "hash";
+    case Phase::Db:
+      return "db";
+    case Phase::Json:
+      return "json";
+  }
+  return "";
+}
+
+PhaseTimer::PhaseTimer(Phase phase) {
+  if (!t_active.on) return;
+  const int p = static_cast<int>(phase);
+  if (t_active.depth[p] > 0) return;  // an enclosing timer counts this time
+  t_active.depth[p] = 1;
+  m_phase = p;
+  m_start = std::chrono::steady_clock::now();
+}
+
+PhaseTimer::~PhaseTimer() {
+  if (m_phase < 0 || !t_active.on) return;
+  t_active.nanos[m_phase] += static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - m_start)
+          .count());
+  t_active.used[m_phase] = true;
+  t_active.depth[m_phase] = 0;
+}
+
+// ---- RequestMetrics ----
+
+RequestMetrics::RequestMetrics()
+    : m_id(g_nextRegistryId.fetch_add(1, std::memory_order_relaxed)) {
+  m_labels.reserve(kMaxRoutes);
+}
+
+RequestMetrics::~RequestMetrics() = default;
+
+int RequestMetrics::route(const std::string& label) {
+  std::lock_guard<std::mutex> lock(m_mu);
+  for (size_t i = 0; i < m_labels.size(); i++) {
+    if (m_labels[i] == label) return static_cast<int>(i);
+  }
+  if (static_cast<int>(m_labels.size()) >= kMaxRoutes) {
+    throw std::runtime_error("RequestMetrics: too many routes");
+  }
+  m_labels.push_back(label);
+  return static_cast<int>(m_labels.size() - 1);
+}
+
+RequestMetrics::Shard& RequestMetrics::local() {
+  thread_local Shard* t_shard = nullptr;
+  thread_local uint64_t t_owner = 0;
+  if (t_owner != m_id) {
+    auto shard = std::make_unique<Shard>();
+    std::lock_guard<std::mutex> lock(m_mu);
+    t_shard = shard.get();
+    t_owner = m_id;
+    m_shards.push_back(std::move(shard));
+  }
+  return *t_shard;
+}
+
+std::string RequestMetrics::prometheus() const {
+  std::vector<std::string> labels;
+  std::vector<const Shard*> shards;
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    labels = m_labels;
+    for (const auto& s : m_shards) shards.push_back(s.get());
+  }
+
+  auto sum = [&](size_t route, auto pick) {
+    uint64_t v = 0;
+    for (const Shard* s : shards) v += pick(s->routes[route]).load(std::memory_order_relaxed);
+    return v;
+  };
+  auto totals = [&](size_t route, auto pick) {
+    HistogramTotals t;
+    for (const Shard* s : shards) {
+      const Histogram& h = pick(s->routes[route]);
+      for (int i = 0; i < LatencyHistogram::kBuckets; i++) {
+        t.buckets[i] += h.buckets[i].load(std::memory_order_relaxed);
+      }
+      t.count += h.count.load(std::memory_order_relaxed);
+      t.sumMicros += h.sumMicros.load(std::memory_order_relaxed);
+    }
+    return t;
+  };
+  auto routeLabel = [&](std::string& out, size_t route) {
+    out += "route=\"";
+    appendEscaped(out, labels[route]);
+    out += '"';
+  };
+  // `extra` holds any labels after route, e.g. `,phase="db"`.
+  auto histogram = [&](std::string& out, const char* name, size_t route,
+                       const std::string& extra, const HistogramTotals& t) {
+    uint64_t cumulative = 0;
+    for (int i = 0; i < LatencyHistogram::kBuckets; i++) {
+      cumulative += t.buckets[i];
+      out += name;
+      out += "_bucket{";
+      routeLabel(out, route);
+      out += extra;
+      out += ",le=\"";
+      const uint64_t le = LatencyHistogram::upperBoundMicros(i);
+      if (le) {
+        appendSeconds(out, le);
+      } else {
+        out += "+Inf";
+      }
+      out += "\"} ";
+      appendU64(out, cumulative);
+      out += '\n';
+    }
+    out += name;
+    out += "_sum{";
+    routeLabel(out, route);
+    out += extra;
+    out += "} ";
+    appendSeconds(out, t.sumMicros);
+    out += '\n';
+    out += name;
+    out += "_count{";
+    routeLabel(out, route);
+    out += extra;
+    out += "} ";
+    appendU64(out, t.count);
+    out += '\n';
+  };
+
+  std::string out;
+  out.reserve(4096 + labels.size() * 8192);
+
+  header(out, "flowfund_http_requests_total", "Requests handled, by route and status class.",
+         "counter");
+  for (size_t r = 0; r < labels.size(); r++) {
+    for (int c = 0; c < 5; c++) {
+      const uint64_t v = sum(r, [c](const RouteShard& s) -> const std::atomic<uint64_t>& {
+        return s.statusClass[c];
+      });
+      if (!v) continue;
+      out += "flowfund_http_requests_total{";
+      routeLabel(out, r);
+      out += ",status=\"";
+      out += static_cast<char>('1' + c);
+      out += "xx\"} ";
+      appendU64(out, v);
+      out += '\n';
+    }
+  }
+
+  header(out, "flowfund_http_request_bytes_total", "Request body bytes received.", "counter");
+  for (size_t r = 0; r < labels.size(); r++) {
+    out += "flowfund_http_request_bytes_total{";
+    routeLabel(out, r);
+    out += "} ";
+    appendU64(out, sum(r, [](const RouteShard& s) -> const std::atomic<uint64_t>& {
+                return s.bytesIn;
+              }));
+    out += '\n';
+  }
+
+  header(out, "flowfund_http_response_bytes_total",
+         "Response body bytes sent (after compression).", "counter");
+  for (size_t r = 0; r < labels.size(); r++) {
+    out += "flowfund_http_response_bytes_total{";
+    routeLabel(out, r);
+    out += "} ";
+    appendU64(out, sum(r, [](const RouteShard& s) -> const std::atomic<uint64_t>& {
+                return s.bytesOut;
+              }));
+    out += '\n';
+  }
+
+  header(out, "flowfund_http_request_duration_seconds", "Handler wall time.", "histogram");
+  for (size_t r = 0; r < labels.size(); r++) {
+    const HistogramTotals t =
+        totals(r, [](const RouteShard& s) -> const Histogram& { return s.total; });
+    if (t.count) histogram(out, "flowfund_http_request_duration_seconds", r, "", t);
+  }
+
+  header(out, "flowfund_http_request_phase_seconds",
+         "Time per request in each phase, for requests that entered it.", "histogram");
+  for (size_t r = 0; r < labels.size(); r++) {
+    for (int p = 0; p < kPhases; p++) {
+      const HistogramTotals t =
+          totals(r, [p](const RouteShard& s) -> const Histogram& { return s.phases[p]; });
+      if (!t.count) continue;
+      const std::string extra =
+          std::string(",phase=\"") + phaseName(static_cast<Phase>(p)) + '"';
+      histogram(out, "flowfund_http_request_phase_seconds", r, extra, t);
+    }
+  }
+  return out;
+}
+
+// ---- RequestTimer ----
+
+RequestTimer::RequestTimer(RequestMetrics& metrics, int route)
+    : m_metrics(metrics), m_route(route), m_start(std::chrono::steady_clock::now()) {
+  t_active = Active{};
+  t_active.on = true;
+}
+
+RequestTimer::~RequestTimer() {
+  if (!m_done) finish(500, 0, 0);
+  t_active.on = false;
+}
+
+void RequestTimer::finish(int status, uint64_t bytesIn, uint64_t bytesOut) {
+  if (m_done) return;
+  m_done = true;
+
+  const uint64_t total = micros(std::chrono::steady_clock::now() - m_start);
+  RequestMetrics::RouteShard& r = m_metrics.local().routes[m_route];
+
+  bump(r.statusClass[std::clamp(status / 100 - 1, 0, 4)]);
+  bump(r.bytesIn, bytesIn);
+  bump(r.bytesOut, bytesOut);
+
+  auto observe = [](RequestMetrics::Histogram& h, uint64_t us) {
+    bump(h.buckets[LatencyHistogram::bucketFor(us)]);
+    bump(h.count);
+    bump(h.sumMicros, us);
+  };
+  observe(r.total, total);
+  for (int p = 0; p < kPhases; p++) {
+    if (t_active.used[p]) observe(r.phases[p], t_active.nanos[p] / 1000);
+  }
+}
+
+// ---- exposition helpers ----
+
+void writeGauge(std::string& out, std::string_view name, std::string_view help,
+                double value) {
+  header(out, name, help, "gauge");
+  char buf[32];
+  const int n = std::snprintf(buf, sizeof(buf), "%.17g", value);
+  out += name;
+  out += ' ';
+  out.append(buf, static_cast<size_t>(n));
+  out += '\n';
+}
+
+void writeCounter(std::string& out, std::string_view name, std::string_view help,
+                  uint64_t value) {
+  header(out, name, help, "counter");
+  out += name;
+  out += ' ';
+  appendU64(out, value);
+  out += '\n';
+}
+
+}  // namespace Metrics
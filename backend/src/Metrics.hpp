@@ -0,0 +1,144 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Metrics {
+
+// Lock-free latency histogram with power-of-two microsecond buckets:
+// bucket i counts samples <= 2^i us, the last bucket is +Inf.
+class LatencyHistogram {
+ public:
+  static constexpr int kBuckets = 24;  // 1us .. ~4.2s, then +Inf
+
+  void record(uint64_t micros);
+
+  uint64_t count() const { return m_count.load(std::memory_order_relaxed); }
+  uint64_t sumMicros() const { return m_sum.load(std::memory_order_relaxed); }
+  uint64_t bucket(int i) const {
+    return m_buckets[i].load(std::memory_order_relaxed);
+  }
+
+  // Upper bound of bucket i in microseconds (0 for the +Inf bucket).
+  static uint64_t upperBoundMicros(int i);
+
+  // Bucket a sample falls in; constant time.
+  static int bucketFor(uint64_t micros);
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> m_buckets{};
+  std::atomic<uint64_t> m_count{0};
+  std::atomic<uint64_t> m_sum{0};
+};
+
+// Where a request spends its time. Auth is JWT verification (or a cache
+// hit), Hash is PBKDF2 including the wait for a hash worker, Db covers
+// pool checkout and statements, Json is parsing request bodies and
+// building, dumping and compressing responses.
+enum class Phase { Auth, Hash, Db, Json };
+inline constexpr int kPhases = 4;
+
+const char* phaseName(Phase p);
+
+// Adds the scope's wall time to `phase` of the request running on this
+// thread (see RequestTimer). Nested timers of the same phase count once;
+// outside a timed request this is a no-op.
+class PhaseTimer {
+ public:
+  explicit PhaseTimer(Phase phase);
+  ~PhaseTimer();
+
+  PhaseTimer(const PhaseTimer&) = delete;
+  PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+ private:
+  int m_phase = -1;  // -1 when not counting
+  std::chrono::steady_clock::time_point m_start;
+};
+
+// Per-route request counters: count by status class, bytes in and out,
+// and latency histograms for the whole handler and each phase.
+//
+// Every thread writes its own shard (allocated on its first request and
+// kept for the life of the registry), so recording is a handful of plain
+// increments with no shared cache lines; a scrape sums the shards. Routes
+// are registered at startup, up to kMaxRoutes.
+class RequestMetrics {
+ public:
+  static constexpr int kMaxRoutes = 64;
+
+  RequestMetrics();
+  ~RequestMetrics();
+
+  RequestMetrics(const RequestMetrics&) = delete;
+  RequestMetrics& operator=(const RequestMetrics&) = delete;
+
+  // Id for `label` (e.g. "GET /transactions/:id"), registering it on
+  // first use. Throws once kMaxRoutes labels exist.
+  int route(const std::string& label);
+
+  // Prometheus text exposition (format 0.0.4) of every route.
+  std::string prometheus() const;
+
+ private:
+  friend class RequestTimer;
+
+  struct Histogram {
+    std::array<std::atomic<uint64_t>, LatencyHistogram::kBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumMicros{0};
+  };
+
+  struct RouteShard {
+    std::array<std::atomic<uint64_t>, 5> statusClass{};  // 1xx .. 5xx
+    std::atomic<uint64_t> bytesIn{0};
+    std::atomic<uint64_t> bytesOut{0};
+    Histogram total;
+    std::array<Histogram, kPhases> phases;
+  };
+
+  struct Shard {
+    std::array<RouteShard, kMaxRoutes> routes;
+  };
+
+  Shard& local();
+
+  mutable std::mutex m_mu;
+  std::vector<std::string> m_labels;
+  std::vector<std::unique_ptr<Shard>> m_shards;
+  const uint64_t m_id;  // tells this registry's thread-local shard apart
+};
+
+// Times one request on the current thread: phases timed while it is alive
+// are attributed to it, and finish() records it under `route`. A timer
+// destroyed without finish() (the handler threw) records a 500.
+class RequestTimer {
+ public:
+  RequestTimer(RequestMetrics& metrics, int route);
+  ~RequestTimer();
+
+  RequestTimer(const RequestTimer&) = delete;
+  RequestTimer& operator=(const RequestTimer&) = delete;
+
+  void finish(int status, uint64_t bytesIn, uint64_t bytesOut);
+
+ private:
+  RequestMetrics& m_metrics;
+  const int m_route;
+  const std::chrono::steady_clock::time_point m_start;
+  bool m_done = false;
+};
+
+// Exposition helpers for values kept elsewhere (pool sizes, cache hits).
+void writeGauge(std::string& out, std::string_view name, std::string_view help,
+                double value);
+void writeCounter(std::string& out, std::string_view name, std::string_view help,
+                  uint64_t value);
+
+}  // namespace Metrics
@@ -0,0 +1,115 @@
+#include "PgBinary.hpp"
+
+namespace PgBinary {
+
+static uint16_t be16(const unsigned char* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+static uint32_t be32(const unsigned char* p) {
+  return (uint32_t{p[0]} << 24) | (uint32_t{p[1]} << 16) |
+         (uint32_t{p[2]} << 8) | uint32_t{p[3]};
+}
+
+static const unsigned char* raw(const PGresult* r, int row, int col) {
+  return reinterpret_cast<const unsigned char*>(PQgetvalue(r, row, col));
+}
+
+int32_t int4(const PGresult* r, int row, int col) {
+  if (PQgetisnull(r, row, col)) return 0;
+  return static_cast<int32_t>(be32(raw(r, row, col)));
+}
+
+int64_t int8(const PGresult* r, int row, int col) {
+  if (PQgetisnull(r, row, col)) return 0;
+  const unsigned char* p = raw(r, row, col);
+  return static_cast<int64_t>((uint64_t{be32(p)} << 32) | be32(p + 4));
+}
+
+std::string_view text(const PGresult* r, int row, int col) {
+  return std::string_view(PQgetvalue(r, row, col),
+                          static_cast<size_t>(PQgetlength(r, row, col)));
+}
+
+int32_t date(const PGresult* r, int row, int col) {
+  return int4(r, row, col);
+}
+
+int64_t numericCents(const PGresult* r, int row, int col) {
+  if (PQgetisnull(r, row, col)) return 0;
+
+  // Wire format: int16 ndigits, int16 weight, uint16 sign, uint16 dscale,
+  // then ndigits base-10000 digits; digit i is worth 10000^(weight - i).
+  const unsigned char* p = raw(r, row, col);
+  const int ndigits = static_cast<int16_t>(be16(p));
+  const int weight = static_cast<int16_t>(be16(p + 2));
+  const uint16_t sign = be16(p + 4);
+  if (sign == 0xC000) return 0;  // NaN
+
+  int64_t cents = 0;
+  for (int i = 0; i < ndigits; i++) {
+    const int64_t d = be16(p + 8 + 2 * i);
+    const int exp = weight - i;
+    if (exp >= 0) {
+      int64_t v = d * 100;
+      for (int e = 0; e < exp; e++) v *= 10000;
+      cents += v;
+    } else if (exp == -1) {
+      cents += d / 100;  // first fractional group: .XXyy -> XX cents
+    }
+  }
+  return sign == 0x4000 ? -cents : cents;
+}
+
+int formatDate(int32_t pgDays, char* out) {
+  // Civil-from-days (H. Hinnant), shifted from the 2000-01-01 epoch.
+  int64_t z = int64_t{pgDays} + 10957 + 719468;
+  const int64_t era = (z >= 0 ? z : z - 146096) / 146097;
+  const int64_t doe = z - era * 146097;
+  const int64_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const int64_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const int64_t mp = (5 * doy + 2) / 153;
+  const int d = static_cast<int>(doy - (153 * mp + 2) / 5 + 1);
+  const int m = static_cast<int>(mp < 10 ? mp + 3 : mp - 9);
+  const int y = static_cast<int>(yoe + era * 400 + (m <= 2));
+
+  out[0] = static_cast<char>('0' + (y / 1000) % 10);
+  out[1] = static_cast<char>('0' + (y / 100) % 10);
+  out[2] = static_cast<char>('0' + (y / 10) % 10);
+  out[3] = static_cast<char>('0' + y % 10);
+  out[4] = '-';
+  out[5] = static_cast<char>('0' + m / 10);
+  out[6] = static_cast<char>('0' + m % 10);
+  out[7] = '-';
+  out[8] = static_cast<char>('0' + d / 10);
+  out[9] = static_cast<char>('0' + d % 10);
+  out[10] = '\0';
+  return 10;
+}
+
+std::optional<int32_t> parseDate(std::string_view s) {
+  if (s.size() != 10 || s[4] != '-' || s[7] != '-') return std::nullopt;
+  for (size_t i : {0, 1, 2, 3, 5, 6, 8, 9}) {
+    if (s[i] < '0' || s[i] > '9') return std::nullopt;
+  }
+  auto num = [&](size_t at, size_t len) {
+    int v = 0;
+    for (size_t i = at; i < at + len; i++) v = v * 10 + (s[i] - '0');
+    return v;
+  };
+  const int y = num(0, 4), m = num(5, 2), d = num(8, 2);
+  if (y < 1 || m < 1 || m > 12 || d < 1) return std::nullopt;
+  static const int kDays[] = {31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31};
+  const bool leap = (y % 4 == 0 && y % 100 != 0) || y % 400 == 0;
+  if (d > kDays[m - 1] + (m == 2 && leap ? 1 : 0)) return std::nullopt;
+
+  // Days-from-civil (H. Hinnant), shifted to the 2000-01-01 epoch.
+  const int yy = y - (m <= 2);
+  const int era = yy / 400;
+  const int yoe = yy - era * 400;
+  const int doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+  const int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+  return static_cast<int32_t>(era * 146097 + doe - 719468 - 10957);
+}
+
+}  // namespace PgBinary
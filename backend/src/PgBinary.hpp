@@ -0,0 +1,34 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include <libpq-fe.h>
+
+// Decoders for libpq binary-format results (resultFormat = 1). Values are
+// read straight out of the PGresult buffer in network byte order, with no
+// text round trip and no allocation.
+namespace PgBinary {
+
+int32_t int4(const PGresult* r, int row, int col);
+int64_t int8(const PGresult* r, int row, int col);
+
+// TEXT/VARCHAR columns are sent as raw bytes; the view points into `r`.
+std::string_view text(const PGresult* r, int row, int col);
+
+// DATE: days since 2000-01-01.
+int32_t date(const PGresult* r, int row, int col);
+
+// NUMERIC scaled to hundredths (cents). Digits below 0.01 are truncated,
+// which is exact for NUMERIC(12,2) columns and their SUMs. NaN reads as 0.
+int64_t numericCents(const PGresult* r, int row, int col);
+
+// Writes a DATE value as "YYYY-MM-DD" into `out` (at least 11 bytes,
+// NUL-terminated). Returns the length written (10).
+int formatDate(int32_t pgDays, char* out);
+
+// Inverse of formatDate: strict "YYYY-MM-DD" (a real calendar day, year
+// 0001-9999) to days since 2000-01-01; nullopt for anything else.
+std::optional<int32_t> parseDate(std::string_view s);
+
+}  // namespace PgBinary
@@ -0,0 +1,40 @@
+#include "ResponseCache.hpp"
+
+ResponseCache::ResponseCache(size_t maxBytes, size_t maxEntryBytes)
+    : m_maxBytes(maxBytes), m_maxEntryBytes(maxEntryBytes), m_lru(maxBytes) {}
+
+std::string ResponseCache::key(long userId, const std::string& target) {
+  std::string k = std::to_string(userId);
+  k += ' ';
+  k += target;
+  return k;
+}
+
+ResponseCache::Body ResponseCache::get(long userId, const std::string& target,
+                                       const std::string& etag) {
+  const std::string k = key(userId, target);
+  auto e = m_lru.get(k);
+  if (!e) {
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  if (e->etag != etag) {
+    // Built before the user's last write; it can never match again.
+    m_lru.erase(k);
+    m_stale.fetch_add(1, std::memory_order_relaxed);
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+  m_hits.fetch_add(1, std::memory_order_relaxed);
+  return e->body;
+}
+
+ResponseCache::Body ResponseCache::put(long userId, const std::string& target,
+                                       const std::string& etag, std::string body,
+                                       Compression::Encoding encoding) {
+  auto shared = std::make_shared<const Stored>(Stored{std::move(body), encoding});
+  if (shared->bytes.size() <= m_maxEntryBytes) {
+    m_lru.put(key(userId, target), Entry{etag, shared});
+  }
+  return shared;
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "Compression.hpp"
+#include "LruCache.hpp"
+
+// Serialized GET response bodies per (user, request target), so a second
+// device polling the same view is served stored bytes without a database
+// round trip or JSON building. Each body is stored with the ETag it was
+// built under (see DataVersions); once a write bumps the user's version
+// the ETag no longer matches and the entry is dropped on its next lookup,
+// so a stale body is never served. Bounded by total bytes, LRU evicted.
+//
+// Bodies are kept as sent, already compressed; callers key them by the
+// negotiated encoding as well as the target, so a hit costs no deflate.
+class ResponseCache {
+ public:
+  struct Stored {
+    std::string bytes;
+    Compression::Encoding encoding;
+  };
+  using Body = std::shared_ptr<const Stored>;
+
+  // `maxBytes` is the total budget; bodies over `maxEntryBytes` are not
+  // kept.
+  ResponseCache(size_t maxBytes, size_t maxEntryBytes);
+
+  // The body stored for `target` under exactly `etag`, or null.
+  Body get(long userId, const std::string& target, const std::string& etag);
+
+  // Stores `body`, encoded as `encoding`, when small enough and returns it
+  // shared, for serving.
+  Body put(long userId, const std::string& target, const std::string& etag,
+           std::string body, Compression::Encoding encoding);
+
+  uint64_t hits() const { return m_hits.load(std::memory_order_relaxed); }
+  uint64_t misses() const { return m_misses.load(std::memory_order_relaxed); }
+  uint64_t stale() const { return m_stale.load(std::memory_order_relaxed); }
+  uint64_t evictions() const { return m_lru.evictions(); }
+  size_t entries() const { return m_lru.size(); }
+  size_t bytes() const { return m_lru.weight(); }
+  size_t maxBytes() const { return m_maxBytes; }
+
+ private:
+  struct Entry {
+    std::string etag;
+    Body body;
+  };
+
+  // Key, ETag, body and a rough allocation overhead.
+  struct Weigh {
+    size_t operator()(const std::string& key, const Entry& e) const {
+      return key.size() + e.etag.size() + e.body->bytes.size() + 128;
+    }
+  };
+
+  static std::string key(long userId, const std::string& target);
+
+  const size_t m_maxBytes;
+  const size_t m_maxEntryBytes;
+  ShardedLru<std::string, Entry, std::hash<std::string>, Weigh> m_lru;
+  std::atomic<uint64_t> m_hits{0};
+  std::atomic<uint64_t> m_misses{0};
+  std::atomic<uint64_t> m_stale{0};
+};
@@ -0,0 +1,94 @@
+#include "Rollup.hpp"
+
+#include "PgBinary.hpp"
+#include "Statements.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+
+namespace Rollup {
+
+namespace {
+
+// 2000-01-01 (day 0) was a Saturday, so Mondays are days 2, 9, ...
+int32_t weekStart(int32_t day) {
+  int32_t sinceMonday = (day - 2) % 7;
+  if (sinceMonday < 0) sinceMonday += 7;
+  return day - sinceMonday;
+}
+
+std::string dayText(int32_t day) {
+  char buf[11];
+  PgBinary::formatDate(day, buf);
+  return buf;
+}
+
+// Empty buckets for every month or week of the year, in order, so the
+// query rows can be merged in with one forward walk.
+std::vector<Bucket> calendar(int year, Group group) {
+  std::vector<Bucket> out;
+  if (group == Group::Month) {
+    for (int m = 1; m <= 12; m++) {
+      char key[8];
+      std::snprintf(key, sizeof(key), "%04d-%02d", year, m);
+      out.push_back({key});
+    }
+  } else {
+    const int32_t first = *PgBinary::parseDate(std::to_string(year) + "-01-01");
+    const int32_t last = *PgBinary::parseDate(std::to_string(year) + "-12-31");
+    for (int32_t d = weekStart(first); d <= last; d += 7) out.push_back({dayText(d)});
+  }
+  return out;
+}
+
+}  // namespace
+
+std::optional<Group> parseGroup(const std::string& s) {
+  if (s == "month") return Group::Month;
+  if (s == "category") return Group::Category;
+  if (s == "week") return Group::Week;
+  return std::nullopt;
+}
+
+std::vector<Bucket> fetch(Db& db, long userId, int year, Group group) {
+  char start[32], end[32];
+  std::snprintf(start, sizeof(start), "%04d-01-01", year);
+  std::snprintf(end, sizeof(end), "%04d-01-01", year + 1);
+  const std::string user = std::to_string(userId);
+  const char* params[3] = {user.c_str(), start, end};
+
+  const Sql::Statement& st = group == Group::Month    ? Sql::kRollupMonths
+                             : group == Group::Week   ? Sql::kRollupWeeks
+                                                      : Sql::kRollupCategories;
+  PGresult* r = Sql::exec(db, st, params, Sql::kBinaryResult);
+  if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
+    const std::string err = r ? PQresultErrorMessage(r) : PQerrorMessage(db.conn());
+    if (r) PQclear(r);
+    throw std::runtime_error("Rollup failed: " + err);
+  }
+
+  std::vector<Bucket> out = group == Group::Category ? std::vector<Bucket>()
+                                                     : calendar(year, group);
+  size_t slot = 0;
+  for (int i = 0; i < PQntuples(r); i++) {
+    Bucket b;
+    if (group == Group::Category) {
+      b.key = std::string(PgBinary::text(r, i, 0));
+    } else {
+      // Rows are ordered like the calendar; skip forward to the match.
+      b.key = dayText(PgBinary::date(r, i, 0));
+      if (group == Group::Month) b.key.resize(7);
+      while (slot < out.size() && out[slot].key != b.key) slot++;
+      if (slot == out.size()) break;
+    }
+    b.incomeCents = PgBinary::int8(r, i, 1);
+    b.expenseCents = PgBinary::int8(r, i, 2);
+    b.count = PgBinary::int8(r, i, 3);
+    if (group == Group::Category) out.push_back(std::move(b));
+    else out[slot] = std::move(b);
+  }
+  PQclear(r);
+  return out;
+}
+
+}  // namespace Rollup
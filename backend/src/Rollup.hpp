@@ -0,0 +1,31 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Db.hpp"
+
+// GET /summary/rollup: income/expense/net per month, category or week of
+// one calendar year, each computed by a single grouped statement.
+namespace Rollup {
+
+enum class Group { Month, Category, Week };
+
+// "month", "category" or "week"; nullopt for anything else.
+std::optional<Group> parseGroup(const std::string& s);
+
+struct Bucket {
+  std::string key;  // "YYYY-MM", the category, or the week's Monday
+  int64_t incomeCents = 0;
+  int64_t expenseCents = 0;
+  int64_t count = 0;
+};
+
+// Months and weeks come back complete and in order, empty ones as zeros
+// (the first week may start in December of the year before). Categories
+// list only those with transactions that year. Throws std::runtime_error
+// on a database error.
+std::vector<Bucket> fetch(Db& db, long userId, int year, Group group);
+
+}  // namespace Rollup
@@ -0,0 +1,201 @@
+#include "SqliteStore.hpp"
+
+#include "PgBinary.hpp"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+// The Postgres schema minus what SQLite cannot express (triggers keeping
+// aggregates, tsvector). Amounts are integer cents; dates are YYYY-MM-DD.
+const char* kSchema = R"sql(
+CREATE TABLE IF NOT EXISTS users (
+  id INTEGER PRIMARY KEY,
+  name TEXT NOT NULL,
+  email TEXT NOT NULL UNIQUE,
+  password_hash TEXT NOT NULL,
+  created_at TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP
+);
+
+CREATE TABLE IF NOT EXISTS transactions (
+  id INTEGER PRIMARY KEY,
+  user_id INTEGER NOT NULL REFERENCES users(id) ON DELETE CASCADE,
+  type TEXT NOT NULL CHECK (type IN ('INCOME','EXPENSE')),
+  amount_cents INTEGER NOT NULL CHECK (amount_cents > 0),
+  currency TEXT NOT NULL DEFAULT 'CAD',
+  tx_date TEXT NOT NULL,
+  category TEXT NOT NULL,
+  title TEXT NOT NULL,
+  note TEXT NOT NULL DEFAULT '',
+  created_at TEXT NOT NULL DEFAULT CURRENT_TIMESTAMP
+);
+
+CREATE INDEX IF NOT EXISTS idx_transactions_user_date_id
+  ON transactions(user_id, tx_date DESC, id DESC);
+-- Covers the summary SUMs, so they never touch the table.
+CREATE INDEX IF NOT EXISTS idx_transactions_user_type_amount
+  ON transactions(user_id, type, amount_cents);
+)sql";
+
+std::atomic<uint64_t> g_nextStoreId{1};
+
+std::string_view columnText(sqlite3_stmt* s, int col) {
+  const auto* p = reinterpret_cast<const char*>(sqlite3_column_text(s, col));
+  return p ? std::string_view(p, static_cast<size_t>(sqlite3_column_bytes(s, col)))
+           : std::string_view();
+}
+
+void bindText(sqlite3_stmt* s, int i, const std::string& v) {
+  sqlite3_bind_text(s, i, v.c_str(), static_cast<int>(v.size()), SQLITE_STATIC);
+}
+
+[[noreturn]] void fail(Database& db, const char* what) {
+  throw std::runtime_error(std::string(what) + ": " + sqlite3_errmsg(db.get()));
+}
+
+}  // namespace
+
+SqliteStore::SqliteStore(std::string path)
+    : m_path(std::move(path)), m_id(g_nextStoreId++), m_writer(m_path) {
+  m_writer.exec("PRAGMA foreign_keys=ON");
+  m_writer.exec(kSchema);
+  m_thread = std::thread([this] { writerLoop(); });
+}
+
+SqliteStore::~SqliteStore() {
+  {
+    std::lock_guard<std::mutex> lock(m_mu);
+    m_stop = true;
+  }
+  m_cv.notify_one();
+  m_thread.join();
+}
+
+void SqliteStore::writerLoop() {
+  std::unique_lock<std::mutex> lock(m_mu);
+  while (true) {
+    m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+    if (m_queue.empty()) return;  // stopping, nothing left to run
+    auto job = std::move(m_queue.front());
+    m_queue.pop_front();
+    lock.unlock();
+    job();
+    lock.lock();
+  }
+}
+
+Database& SqliteStore::reader() {
+  // Closed when the thread exits.
+  thread_local std::unordered_map<uint64_t, std::unique_ptr<Database>> readers;
+  auto& conn = readers[m_id];
+  if (!conn) {
+    conn = std::make_unique<Database>(m_path);
+    conn->exec("PRAGMA query_only=ON");
+  }
+  return *conn;
+}
+
+std::optional<long> SqliteStore::createUser(const std::string& name,
+                                            const std::string& email,
+                                            const std::string& passwordHash) {
+  return write([&](Database& db) -> std::optional<long> {
+    auto st = db.prepare(
+        "INSERT INTO users(name,email,password_hash) VALUES(?,?,?)");
+    bindText(st, 1, name);
+    bindText(st, 2, email);
+    bindText(st, 3, passwordHash);
+    const int rc = sqlite3_step(st);
+    if (rc == SQLITE_CONSTRAINT) return std::nullopt;
+    if (rc != SQLITE_DONE) fail(db, "insert user");
+    return static_cast<long>(sqlite3_last_insert_rowid(db.get()));
+  });
+}
+
+std::optional<SqliteStore::User> SqliteStore::findUser(const std::string& email) {
+  Database& db = reader();
+  auto st = db.prepare("SELECT id, password_hash FROM users WHERE email=?");
+  bindText(st, 1, email);
+  const int rc = sqlite3_step(st);
+  if (rc == SQLITE_DONE) return std::nullopt;
+  if (rc != SQLITE_ROW) fail(db, "find user");
+  return User{static_cast<long>(sqlite3_column_int64(st, 0)),
+              std::string(columnText(st, 1))};
+}
+
+long SqliteStore::insertTransaction(const NewTransaction& t) {
+  return write([&](Database& db) {
+    auto st = db.prepare(
+        "INSERT INTO transactions"
+        "(user_id,type,amount_cents,currency,tx_date,category,title,note) "
+        "VALUES(?,?,?,?,?,?,?,?)");
+    sqlite3_bind_int64(st, 1, t.userId);
+    bindText(st, 2, t.type);
+    sqlite3_bind_int64(st, 3, t.amountCents);
+    bindText(st, 4, t.currency);
+    bindText(st, 5, t.date);
+    bindText(st, 6, t.category);
+    bindText(st, 7, t.title);
+    bindText(st, 8, t.note);
+    if (sqlite3_step(st) != SQLITE_DONE) fail(db, "insert transaction");
+    return static_cast<long>(sqlite3_last_insert_rowid(db.get()));
+  });
+}
+
+bool SqliteStore::deleteTransaction(long userId, long id) {
+  return write([&](Database& db) {
+    auto st = db.prepare("DELETE FROM transactions WHERE id=? AND user_id=?");
+    sqlite3_bind_int64(st, 1, id);
+    sqlite3_bind_int64(st, 2, userId);
+    if (sqlite3_step(st) != SQLITE_DONE) fail(db, "delete transaction");
+    return sqlite3_changes(db.get()) == 1;
+  });
+}
+
+void SqliteStore::listTransactions(
+    long userId, int limit, const std::optional<Cursor::Position>& after,
+    const std::function<void(const TransactionRow&)>& each) {
+  Database& db = reader();
+  const char* cols =
+      "SELECT id,type,amount_cents,currency,tx_date,category,title,note "
+      "FROM transactions WHERE user_id=?1 ";
+  auto st = db.prepare(std::string(cols) +
+                       (after ? "AND (tx_date, id) < (?2, ?3) " : "") +
+                       "ORDER BY tx_date DESC, id DESC LIMIT ?4");
+  sqlite3_bind_int64(st, 1, userId);
+  if (after) {
+    char day[11];
+    PgBinary::formatDate(static_cast<int32_t>(after->value), day);
+    sqlite3_bind_text(st, 2, day, 10, SQLITE_TRANSIENT);
+    sqlite3_bind_int64(st, 3, after->id);
+  }
+  sqlite3_bind_int(st, 4, limit);
+
+  int rc;
+  while ((rc = sqlite3_step(st)) == SQLITE_ROW) {
+    TransactionRow row;
+    row.id = sqlite3_column_int64(st, 0);
+    row.type = columnText(st, 1);
+    row.amountCents = sqlite3_column_int64(st, 2);
+    row.currency = columnText(st, 3);
+    row.date = PgBinary::parseDate(columnText(st, 4)).value_or(0);
+    row.category = columnText(st, 5);
+    row.title = columnText(st, 6);
+    row.note = columnText(st, 7);
+    each(row);
+  }
+  if (rc != SQLITE_DONE) fail(db, "list transactions");
+}
+
+SqliteStore::Totals SqliteStore::summary(long userId) {
+  Database& db = reader();
+  auto st = db.prepare(
+      "SELECT COALESCE(SUM(amount_cents) FILTER (WHERE type='INCOME'),0),"
+      " COALESCE(SUM(amount_cents) FILTER (WHERE type='EXPENSE'),0)"
+      " FROM transactions WHERE user_id=?");
+  sqlite3_bind_int64(st, 1, userId);
+  if (sqlite3_step(st) != SQLITE_ROW) fail(db, "summary");
+  return {sqlite3_column_int64(st, 0), sqlite3_column_int64(st, 1)};
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+#include "Cursor.hpp"
+#include "TransactionRow.hpp"
+#include "db/Database.hpp"
+
+// Embedded storage for DB_BACKEND=sqlite (single-tenant and edge
+// deploys): one WAL-mode database file, no server. Each thread that reads
+// gets its own read-only connection, so reads never wait on each other or
+// on the writer. All writes run in order on one writer thread, the only
+// write concurrency SQLite has without busy retries.
+class SqliteStore {
+ public:
+  // `path` must be a file: every connection opens it separately.
+  explicit SqliteStore(std::string path);
+  ~SqliteStore();
+
+  SqliteStore(const SqliteStore&) = delete;
+  SqliteStore& operator=(const SqliteStore&) = delete;
+
+  struct User {
+    long id = 0;
+    std::string passwordHash;
+  };
+
+  struct NewTransaction {
+    long userId = 0;
+    std::string type;
+    int64_t amountCents = 0;
+    std::string currency, date, category, title, note;
+  };
+
+  struct Totals {
+    int64_t incomeCents = 0;
+    int64_t expenseCents = 0;
+  };
+
+  // nullopt when the email is already registered.
+  std::optional<long> createUser(const std::string& name, const std::string& email,
+                                 const std::string& passwordHash);
+  std::optional<User> findUser(const std::string& email);
+
+  long insertTransaction(const NewTransaction& t);
+  bool deleteTransaction(long userId, long id);
+
+  // Newest first, strictly after `after` (a Date cursor), at most `limit`
+  // rows. The row's views are only valid during the callback.
+  void listTransactions(long userId, int limit,
+                        const std::optional<Cursor::Position>& after,
+                        const std::function<void(const TransactionRow&)>& each);
+
+  Totals summary(long userId);
+
+ private:
+  // This thread's read-only connection, opened on first use.
+  Database& reader();
+
+  // Runs `fn` on the writer thread and waits for it; exceptions are
+  // rethrown here.
+  template <class F>
+  std::invoke_result_t<F, Database&> write(F fn) {
+    std::packaged_task<std::invoke_result_t<F, Database&>()> task(
+        [this, &fn] { return fn(m_writer); });
+    auto result = task.get_future();
+    {
+      std::lock_guard<std::mutex> lock(m_mu);
+      m_queue.push_back([&task] { task(); });
+    }
+    m_cv.notify_one();
+    return result.get();
+  }
+
+  void writerLoop();
+
+  const std::string m_path;
+  const uint64_t m_id;  // keys the thread-local readers
+  Database m_writer;
+
+  std::mutex m_mu;
+  std::condition_variable m_cv;
+  std::deque<std::function<void()>> m_queue;
+  bool m_stop = false;
+  std::thread m_thread;
+};
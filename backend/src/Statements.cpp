@@ -0,0 +1,71 @@
+#include "Statements.hpp"
+
+#include <cstring>
+#include <iterator>
+#include <iostream>
+
+#include "Metrics.hpp"
+
+namespace Sql {
+
+static const Statement* const kAll[] = {
+    &kInsertUser,
+    &kFindUserByEmail,
+    &kInsertTransaction,
+    &kExportTransactions,
+    &kUpdateTransaction,
+    &kPatchTransaction,
+    &kReserveTransactionIds,
+    &kDeleteTransaction,
+    &kSummary,
+    &kRollupMonths,
+    &kRollupCategories,
+    &kRollupWeeks,
+};
+
+// SQLSTATE 26000: invalid_sql_statement_name ("prepared statement does
+// not exist"), e.g. after the server side ran DISCARD ALL.
+static bool isMissingStatement(const PGresult* r) {
+  const char* state = r ? PQresultErrorField(r, PG_DIAG_SQLSTATE) : nullptr;
+  return state && std::strcmp(state, "26000") == 0;
+}
+
+const std::vector<const Statement*>& all() {
+  static const std::vector<const Statement*> statements(std::begin(kAll), std::end(kAll));
+  return statements;
+}
+
+void prepareAll(Db& db) {
+  for (const Statement* st : kAll) {
+    if (!db.prepare(st->name, st->text, st->nParams)) {
+      std::cerr << "Failed to prepare " << st->name << ": "
+                << PQerrorMessage(db.conn()) << "\n";
+    }
+  }
+}
+
+PGresult* exec(Db& db, const Statement& st, const char* const* params,
+               int resultFormat) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  if (!db.prepare(st.name, st.text, st.nParams)) return nullptr;
+
+  PGresult* r = PQexecPrepared(db.conn(), st.name, st.nParams, params,
+                               nullptr, nullptr, resultFormat);
+  if (!isMissingStatement(r)) return r;
+
+  PQclear(r);
+  db.forgetPrepared();
+  if (!db.prepare(st.name, st.text, st.nParams)) return nullptr;
+  return PQexecPrepared(db.conn(), st.name, st.nParams, params, nullptr,
+                        nullptr, resultFormat);
+}
+
+bool send(Db& db, const Statement& st, const char* const* params,
+          int resultFormat) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  if (!db.prepare(st.name, st.text, st.nParams)) return false;
+  return PQsendQueryPrepared(db.conn(), st.name, st.nParams, params, nullptr,
+                             nullptr, resultFormat) == 1;
+}
+
+}  // namespace Sql
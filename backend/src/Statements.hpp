@@ -0,0 +1,144 @@
+#pragma once
+#include <vector>
+
+#include <libpq-fe.h>
+
+#include "Db.hpp"
+
+// Registry of the fixed SQL the API runs. Each statement is PQprepare'd
+// once per pooled connection and executed with PQexecPrepared, so hot
+// endpoints skip Postgres parse/plan on every request.
+namespace Sql {
+
+struct Statement {
+  const char* name;
+  const char* text;
+  int nParams;
+};
+
+// ---- users ----
+
+inline constexpr Statement kInsertUser{
+    "insert_user",
+    "INSERT INTO users(name,email,password_hash) "
+    "VALUES($1,$2,$3) RETURNING id",
+    3};
+
+inline constexpr Statement kFindUserByEmail{
+    "find_user_by_email",
+    "SELECT id, password_hash FROM users WHERE email=$1",
+    1};
+
+// ---- transactions ----
+
+inline constexpr Statement kInsertTransaction{
+    "insert_transaction",
+    "INSERT INTO transactions(user_id,type,amount,currency,tx_date,category,title,note) "
+    "VALUES($1,$2,$3,$4,$5,$6,$7,$8) RETURNING id",
+    8};
+
+// Full history, oldest first, for GET /transactions/export. NULL bounds
+// mean open-ended; same column order as the listing.
+inline constexpr Statement kExportTransactions{
+    "export_transactions",
+    "SELECT id,type,amount,currency,tx_date,category,title,COALESCE(note,'') "
+    "FROM transactions WHERE user_id=$1 "
+    "AND tx_date >= COALESCE($2::date, '-infinity') "
+    "AND tx_date <= COALESCE($3::date, 'infinity') "
+    "ORDER BY tx_date, id",
+    3};
+
+inline constexpr Statement kUpdateTransaction{
+    "update_transaction",
+    "UPDATE transactions SET type=$1, amount=$2, currency=$3, tx_date=$4, "
+    "category=$5, title=$6, note=$7 "
+    "WHERE id=$8 AND user_id=$9 RETURNING id",
+    9};
+
+// PATCH: NULL parameters keep the current value, so a partial edit is
+// one statement and one round trip.
+inline constexpr Statement kPatchTransaction{
+    "patch_transaction",
+    "UPDATE transactions SET type=COALESCE($1,type), "
+    "amount=COALESCE($2::numeric,amount), currency=COALESCE($3,currency), "
+    "tx_date=COALESCE($4::date,tx_date), category=COALESCE($5,category), "
+    "title=COALESCE($6,title), note=COALESCE($7,note) "
+    "WHERE id=$8 AND user_id=$9 RETURNING id",
+    9};
+
+// Hands out $1 ids from the transactions sequence up front, so a bulk
+// COPY (which cannot RETURNING) knows the ids it is writing.
+inline constexpr Statement kReserveTransactionIds{
+    "reserve_transaction_ids",
+    "SELECT nextval('transactions_id_seq') FROM generate_series(1, $1::int)",
+    1};
+
+inline constexpr Statement kDeleteTransaction{
+    "delete_transaction",
+    "DELETE FROM transactions WHERE id=$1 AND user_id=$2 RETURNING id",
+    2};
+
+// user_balances is kept current by triggers on transactions; no row just
+// means the user has not recorded anything yet.
+inline constexpr Statement kSummary{
+    "summary",
+    "SELECT income_cents, expense_cents FROM user_balances WHERE user_id=$1",
+    1};
+
+// ---- rollups (see Rollup) ----
+// $2/$3: half-open [start, end) date range. The monthly and category
+// rollups read the trigger-maintained buckets; weeks cut across months,
+// so they take one GROUP BY pass over the user's rows in the range.
+
+inline constexpr Statement kRollupMonths{
+    "rollup_months",
+    "SELECT month, SUM(income_cents)::bigint, SUM(expense_cents)::bigint, "
+    "SUM(tx_count)::bigint FROM user_monthly_totals "
+    "WHERE user_id=$1 AND month >= $2::date AND month < $3::date "
+    "GROUP BY month ORDER BY month",
+    3};
+
+inline constexpr Statement kRollupCategories{
+    "rollup_categories",
+    "SELECT category, SUM(income_cents)::bigint, SUM(expense_cents)::bigint, "
+    "SUM(tx_count)::bigint FROM user_monthly_totals "
+    "WHERE user_id=$1 AND month >= $2::date AND month < $3::date "
+    "GROUP BY category ORDER BY category",
+    3};
+
+inline constexpr Statement kRollupWeeks{
+    "rollup_weeks",
+    "SELECT date_trunc('week', tx_date)::date, "
+    "COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'INCOME'), 0)::bigint, "
+    "COALESCE(SUM((amount * 100)::bigint) FILTER (WHERE type = 'EXPENSE'), 0)::bigint, "
+    "COUNT(*) FROM transactions "
+    "WHERE user_id=$1 AND tx_date >= $2::date AND tx_date < $3::date "
+    "GROUP BY 1 ORDER BY 1",
+    3};
+
+// Every registered statement, for callers that prepare them on their
+// own schedule (AsyncDb pipelines the PQsendPrepare calls).
+const std::vector<const Statement*>& all();
+
+// Prepares every registered statement on `db`. Used as the pool's
+// on-connect hook, so it also runs again after a PQreset.
+void prepareAll(Db& db);
+
+// Result formats for exec(); binary results are read with PgBinary.
+inline constexpr int kTextResult = 0;
+inline constexpr int kBinaryResult = 1;
+
+// PQexecPrepared with lazy (re-)preparation: a statement the connection
+// has not prepared yet, or one the server no longer knows about, is
+// prepared and the call retried once.
+PGresult* exec(Db& db, const Statement& st, const char* const* params,
+               int resultFormat = kTextResult);
+
+// PQsendQueryPrepared for callers that read results themselves (e.g. in
+// single-row mode). Prepares lazily like exec(), but a statement the
+// server has since forgotten is not retried; it comes back as an error
+// result. False if the query could not be sent.
+bool send(Db& db, const Statement& st, const char* const* params,
+          int resultFormat = kTextResult);
+
+}  // namespace Sql
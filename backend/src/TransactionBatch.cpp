@@ -0,0 +1,235 @@
+#include "TransactionBatch.hpp"
+
+#include "Metrics.hpp"
+#include "PgBinary.hpp"
+#include "Statements.hpp"
+#include "Utils/Money.hpp"
+
+#include <cstring>
+#include <utility>
+
+namespace TransactionBatch {
+
+using json = nlohmann::json;
+
+namespace {
+
+// A string field if present and not null; false if it has the wrong type.
+bool readText(const json& obj, const char* key, std::optional<std::string>& out) {
+  auto it = obj.find(key);
+  if (it == obj.end() || it->is_null()) return true;
+  if (!it->is_string()) return false;
+  out = it->get<std::string>();
+  return true;
+}
+
+const char* param(const std::optional<std::string>& v) {
+  return v ? v->c_str() : nullptr;
+}
+
+const Sql::Statement& statementFor(Kind k) {
+  switch (k) {
+    case Kind::Create: return Sql::kInsertTransaction;
+    case Kind::Update: return Sql::kPatchTransaction;
+    case Kind::Delete: return Sql::kDeleteTransaction;
+  }
+  return Sql::kInsertTransaction;
+}
+
+bool isMissingStatement(const PGresult* r) {
+  const char* state = PQresultErrorField(r, PG_DIAG_SQLSTATE);
+  return state && std::strcmp(state, "26000") == 0;
+}
+
+// One attempt at the pipeline. `stale` reports a prepared statement the
+// server no longer has, which run() answers with one retry.
+Outcome runOnce(Db& db, const std::string& user, const std::vector<Op>& ops,
+                bool& stale) {
+  Outcome out;
+  PGconn* c = db.conn();
+  auto fail = [&](Outcome::Status status, size_t index, std::string message) {
+    if (out.status != Outcome::Status::Ok) return;  // keep the first
+    out.status = status;
+    out.failure = {index, std::move(message)};
+  };
+
+  // Preparing is synchronous, so it has to happen before the pipeline.
+  for (Kind k : {Kind::Create, Kind::Update, Kind::Delete}) {
+    const Sql::Statement& st = statementFor(k);
+    if (!db.prepare(st.name, st.text, st.nParams)) {
+      fail(Outcome::Status::DbError, 0, PQerrorMessage(c));
+      return out;
+    }
+  }
+
+  if (!PQenterPipelineMode(c)) {
+    fail(Outcome::Status::DbError, 0, PQerrorMessage(c));
+    return out;
+  }
+
+  bool sent = PQsendQueryParams(c, "BEGIN", 0, nullptr, nullptr, nullptr,
+                                nullptr, 0) == 1;
+  for (size_t i = 0; i < ops.size() && sent; i++) {
+    const Op& op = ops[i];
+    std::vector<const char*> params;
+    if (op.kind == Kind::Create) {
+      params = {user.c_str(),    param(op.type),  param(op.amount),
+                param(op.currency), param(op.date), param(op.category),
+                param(op.title), param(op.note)};
+    } else if (op.kind == Kind::Update) {
+      params = patchParams(op, user);
+    } else {
+      params = {op.id.c_str(), user.c_str()};
+    }
+    const Sql::Statement& st = statementFor(op.kind);
+    sent = PQsendQueryPrepared(c, st.name, st.nParams, params.data(), nullptr,
+                               nullptr, 0) == 1;
+  }
+  sent = sent && PQpipelineSync(c) == 1;
+  if (!sent) {
+    // Half a pipeline on the wire; start the connection over.
+    fail(Outcome::Status::DbError, 0, PQerrorMessage(c));
+    db.reset();
+    return out;
+  }
+
+  // Each query yields its result followed by a NULL separator.
+  auto nextResult = [c]() {
+    PGresult* r = PQgetResult(c);
+    if (r) {
+      while (PGresult* extra = PQgetResult(c)) PQclear(extra);
+    }
+    return r;
+  };
+
+  PGresult* r = nextResult();
+  if (!r || PQresultStatus(r) != PGRES_COMMAND_OK) {
+    fail(Outcome::Status::DbError, 0, r ? PQresultErrorMessage(r) : PQerrorMessage(c));
+  }
+  if (r) PQclear(r);
+
+  out.ids.resize(ops.size());
+  for (size_t i = 0; i < ops.size(); i++) {
+    r = nextResult();
+    const ExecStatusType st = r ? PQresultStatus(r) : PGRES_FATAL_ERROR;
+    if (st == PGRES_TUPLES_OK && PQntuples(r) == 1) {
+      out.ids[i] = PQgetvalue(r, 0, 0);
+    } else if (st == PGRES_TUPLES_OK) {
+      fail(Outcome::Status::NotFound, i, "Transaction not found");
+    } else if (st != PGRES_PIPELINE_ABORTED) {  // aborted: an earlier op failed
+      if (r && isMissingStatement(r)) stale = true;
+      fail(Outcome::Status::DbError, i, r ? PQresultErrorMessage(r) : PQerrorMessage(c));
+    }
+    if (r) PQclear(r);
+  }
+
+  r = PQgetResult(c);
+  const bool synced = r && PQresultStatus(r) == PGRES_PIPELINE_SYNC;
+  if (r) PQclear(r);
+  if (!synced || !PQexitPipelineMode(c)) {
+    fail(Outcome::Status::DbError, 0, PQerrorMessage(c));
+    db.reset();
+    return out;
+  }
+
+  // The ops ran inside BEGIN, so nothing is visible until this point.
+  const bool commit = out.status == Outcome::Status::Ok;
+  r = PQexec(c, commit ? "COMMIT" : "ROLLBACK");
+  if (commit && (!r || PQresultStatus(r) != PGRES_COMMAND_OK)) {
+    fail(Outcome::Status::DbError, 0, PQerrorMessage(c));
+  }
+  if (r) PQclear(r);
+  if (out.status != Outcome::Status::Ok) out.ids.clear();
+  return out;
+}
+
+}  // namespace
+
+std::string readFields(const json& obj, bool partial, Op& op) {
+  if (!obj.is_object()) return "expected an object";
+
+  const std::pair<const char*, std::optional<std::string>*> texts[] = {
+      {"type", &op.type},         {"currency", &op.currency},
+      {"date", &op.date},         {"category", &op.category},
+      {"title", &op.title},       {"note", &op.note},
+  };
+  for (const auto& [key, dst] : texts) {
+    if (!readText(obj, key, *dst)) return std::string(key) + " must be a string";
+  }
+
+  auto amount = obj.find("amount");
+  if (amount != obj.end() && !amount->is_null()) {
+    if (!amount->is_number()) return "amount must be a number";
+    const auto money = utils::Money::fromNumber(amount->get<double>(),
+                                                op.currency.value_or("CAD"));
+    if (!money || money->cents() <= 0) return "amount must be > 0";
+    op.amount = money->amountString();
+  }
+
+  if (op.type && *op.type != "INCOME" && *op.type != "EXPENSE") {
+    return "type must be INCOME or EXPENSE";
+  }
+  for (const auto* f : {&op.date, &op.category, &op.title}) {
+    if (*f && (*f)->empty()) return "date, category and title must not be empty";
+  }
+  // Checked here so a bad date is a 400, not a failed pipeline.
+  if (op.date && !PgBinary::parseDate(*op.date)) return "date must be YYYY-MM-DD";
+
+  if (!partial) {
+    if (!op.type || !op.amount || !op.date || !op.category || !op.title) {
+      return "type(INCOME/EXPENSE), amount>0, date, category, title required";
+    }
+    if (!op.currency) op.currency = "CAD";
+    if (!op.note) op.note = "";
+  }
+  return "";
+}
+
+std::vector<const char*> patchParams(const Op& op, const std::string& user) {
+  return {param(op.type),     param(op.amount), param(op.currency),
+          param(op.date),     param(op.category), param(op.title),
+          param(op.note),     op.id.c_str(),    user.c_str()};
+}
+
+std::optional<Failure> parse(const json& list, std::vector<Op>& out) {
+  out.reserve(list.size());
+  for (size_t i = 0; i < list.size(); i++) {
+    const json& o = list[i];
+    if (!o.is_object()) return Failure{i, "op must be an object"};
+
+    Op op;
+    auto kind = o.find("op");
+    const std::string name = kind != o.end() && kind->is_string() ? kind->get<std::string>() : "";
+    if (name == "create") op.kind = Kind::Create;
+    else if (name == "update") op.kind = Kind::Update;
+    else if (name == "delete") op.kind = Kind::Delete;
+    else return Failure{i, "op must be create, update or delete"};
+
+    if (op.kind != Kind::Create) {
+      auto id = o.find("id");
+      if (id == o.end() || !id->is_number_integer() || id->get<long long>() <= 0) {
+        return Failure{i, "id must be a positive integer"};
+      }
+      op.id = std::to_string(id->get<long long>());
+    }
+    if (op.kind != Kind::Delete) {
+      std::string err = readFields(o, op.kind == Kind::Update, op);
+      if (!err.empty()) return Failure{i, std::move(err)};
+    }
+    out.push_back(std::move(op));
+  }
+  return std::nullopt;
+}
+
+Outcome run(Db& db, long userId, const std::vector<Op>& ops) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  const std::string user = std::to_string(userId);
+  bool stale = false;
+  Outcome out = runOnce(db, user, ops, stale);
+  if (!stale) return out;
+  db.forgetPrepared();
+  stale = false;
+  return runOnce(db, user, ops, stale);
+}
+
+}  // namespace TransactionBatch
@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Db.hpp"
+#include "nlohmann/json.hpp"
+
+// POST /transactions/batch: a list of create/update/delete ops sent to
+// Postgres in one libpq pipeline inside one transaction, so a client
+// syncing offline edits pays one round trip for the lot (plus the
+// COMMIT) instead of one per edit.
+namespace TransactionBatch {
+
+enum class Kind { Create, Update, Delete };
+
+// One op with its fields already validated and rendered as statement
+// parameters. For updates an unset field means "leave unchanged".
+struct Op {
+  Kind kind = Kind::Create;
+  std::string id;  // update/delete target
+  std::optional<std::string> type, amount, currency, date, category, title,
+      note;
+};
+
+// Reads the transaction fields of `obj` into `op`. With `partial` only
+// the fields present are checked (PATCH semantics); otherwise the same
+// fields POST /transactions requires must all be there. Returns an error
+// message, empty when valid.
+std::string readFields(const nlohmann::json& obj, bool partial, Op& op);
+
+// Parameters for Sql::kPatchTransaction, pointing into `op` and `user`.
+std::vector<const char*> patchParams(const Op& op, const std::string& user);
+
+struct Failure {
+  size_t index = 0;
+  std::string message;
+};
+
+// Validates a JSON array of ops, each {"op": "create"|"update"|"delete",
+// "id": ..., fields...}, into `out`. Updates take PATCH semantics.
+std::optional<Failure> parse(const nlohmann::json& list, std::vector<Op>& out);
+
+struct Outcome {
+  enum class Status { Ok, NotFound, DbError };
+  Status status = Status::Ok;
+  std::vector<std::string> ids;  // per op, on success
+  Failure failure;               // first failing op otherwise
+};
+
+// All ops commit together or not at all; an update/delete that matches
+// no row of this user fails the batch.
+Outcome run(Db& db, long userId, const std::vector<Op>& ops);
+
+}  // namespace TransactionBatch
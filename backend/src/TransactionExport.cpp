@@ -0,0 +1,157 @@
+#include "TransactionExport.hpp"
+
+#include "JsonWriter.hpp"
+#include "Metrics.hpp"
+#include "PgBinary.hpp"
+#include "Statements.hpp"
+#include "TransactionRow.hpp"
+#include "Utils/Money.hpp"
+
+#include <charconv>
+#include <string_view>
+#include <utility>
+
+namespace {
+
+constexpr size_t kPieceSize = 64 * 1024;
+
+// Same columns (and amount/type convention) that POST /transactions/bulk
+// reads, so an export can be re-imported as-is.
+constexpr std::string_view kCsvHeader =
+    "id,date,type,amount,currency,category,title,note\r\n";
+
+void csvField(std::string& out, std::string_view s) {
+  if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+    out.append(s);
+    return;
+  }
+  out += '"';
+  for (char c : s) {
+    if (c == '"') out += '"';
+    out += c;
+  }
+  out += '"';
+}
+
+void appendInt(std::string& out, int64_t v) {
+  char buf[24];
+  out.append(buf, std::to_chars(buf, buf + sizeof(buf), v).ptr);
+}
+
+}  // namespace
+
+TransactionExport::TransactionExport(DbPool::Lease db, Format format, bool gzip)
+    : m_db(std::move(db)), m_format(format) {
+  if (gzip) m_gzip = std::make_unique<GzipStream>();
+  m_text.reserve(kPieceSize + 4096);
+}
+
+TransactionExport::~TransactionExport() {
+  if (m_first) PQclear(m_first);
+  if (!m_running) return;
+  // Client went away mid-stream: stop the server sending the rest.
+  if (PGcancel* cancel = PQgetCancel(m_db->conn())) {
+    char err[256];
+    PQcancel(cancel, err, sizeof(err));
+    PQfreeCancel(cancel);
+  }
+  drain();
+}
+
+bool TransactionExport::start(long userId, const char* startDate,
+                              const char* endDate) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Db);
+  const std::string user = std::to_string(userId);
+  const char* params[3] = {user.c_str(), startDate, endDate};
+  if (!Sql::send(*m_db, Sql::kExportTransactions, params, Sql::kBinaryResult)) {
+    m_error = PQerrorMessage(m_db->conn());
+    return false;
+  }
+  m_running = true;
+  if (!PQsetSingleRowMode(m_db->conn())) {
+    m_error = "could not enter single-row mode";
+    drain();
+    return false;
+  }
+
+  m_first = PQgetResult(m_db->conn());
+  const ExecStatusType st = m_first ? PQresultStatus(m_first) : PGRES_FATAL_ERROR;
+  if (st != PGRES_SINGLE_TUPLE && st != PGRES_TUPLES_OK) {
+    PGresult* r = m_first;
+    m_first = nullptr;
+    fail(r);
+    return false;
+  }
+  return true;
+}
+
+bool TransactionExport::next(std::string& out) {
+  m_text.clear();
+  if (!m_headerDone) {
+    if (m_format == Format::Csv) m_text.append(kCsvHeader);
+    m_headerDone = true;
+  }
+
+  while (m_running && m_text.size() < kPieceSize) {
+    PGresult* r = m_first ? std::exchange(m_first, nullptr)
+                          : PQgetResult(m_db->conn());
+    const ExecStatusType st = r ? PQresultStatus(r) : PGRES_FATAL_ERROR;
+    if (st == PGRES_SINGLE_TUPLE) {
+      writeRow(r);
+      PQclear(r);
+    } else if (st == PGRES_TUPLES_OK) {  // zero-row end marker
+      PQclear(r);
+      drain();
+    } else {
+      fail(r);
+    }
+  }
+
+  const bool more = m_running;
+  if (m_gzip) {
+    m_gzip->write(m_text, out);
+    if (!more && !failed()) m_gzip->finish(out);
+  } else {
+    out.append(m_text);
+  }
+  return more;
+}
+
+void TransactionExport::writeRow(const PGresult* r) {
+  const TransactionRow t = TransactionRow::decode(r, 0);
+  if (m_format == Format::Ndjson) {
+    JsonWriter w(m_text);
+    t.writeJson(w);
+    m_text += '\n';
+    return;
+  }
+
+  char day[11];
+  PgBinary::formatDate(t.date, day);
+  appendInt(m_text, t.id);
+  m_text += ',';
+  m_text.append(day, 10);
+  m_text += ',';
+  m_text.append(t.type);
+  m_text += ',';
+  utils::appendCents(m_text, t.amountCents);
+  for (std::string_view f : {t.currency, t.category, t.title, t.note}) {
+    m_text += ',';
+    csvField(m_text, f);
+  }
+  m_text += "\r\n";
+}
+
+void TransactionExport::fail(PGresult* r) {
+  const char* msg = r ? PQresultErrorMessage(r) : PQerrorMessage(m_db->conn());
+  m_error = (msg && *msg) ? msg : "export query failed";
+  if (r) PQclear(r);
+  drain();
+}
+
+// Reads and discards whatever is left of the query, leaving the
+// connection idle.
+void TransactionExport::drain() {
+  while (PGresult* r = PQgetResult(m_db->conn())) PQclear(r);
+  m_running = false;
+}
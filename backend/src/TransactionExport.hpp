@@ -0,0 +1,53 @@
+#pragma once
+#include <memory>
+#include <string>
+
+#include <libpq-fe.h>
+
+#include "DbPool.hpp"
+#include "Gzip.hpp"
+
+// Streams a user's full transaction history as CSV or NDJSON. The query
+// runs in libpq single-row mode, so only one row is held client-side at
+// a time; the body is produced in ~64 KiB pieces (optionally gzipped)
+// for httplib's chunked content provider. Memory stays constant no
+// matter how many rows the user has.
+//
+// The export holds its pooled connection until it is destroyed. An
+// unfinished query is cancelled then, so the connection goes back clean.
+class TransactionExport {
+ public:
+  enum class Format { Csv, Ndjson };
+
+  TransactionExport(DbPool::Lease db, Format format, bool gzip);
+  ~TransactionExport();
+
+  TransactionExport(const TransactionExport&) = delete;
+  TransactionExport& operator=(const TransactionExport&) = delete;
+
+  // Sends the query and waits for its first result, so a failure can
+  // still be answered with an error status. `startDate`/`endDate` are
+  // inclusive YYYY-MM-DD bounds, nullptr for open-ended.
+  bool start(long userId, const char* startDate, const char* endDate);
+
+  // Appends the next piece of the body to `out` (possibly empty when
+  // compressing). Returns false once the body is complete, or on error.
+  bool next(std::string& out);
+
+  bool failed() const { return !m_error.empty(); }
+  const std::string& error() const { return m_error; }
+
+ private:
+  void writeRow(const PGresult* r);
+  void fail(PGresult* r);
+  void drain();
+
+  DbPool::Lease m_db;
+  const Format m_format;
+  std::unique_ptr<GzipStream> m_gzip;
+  PGresult* m_first = nullptr;  // held by start() for the first next()
+  std::string m_text;           // uncompressed piece being built
+  bool m_running = false;       // query sent and not fully read
+  bool m_headerDone = false;
+  std::string m_error;
+};
@@ -0,0 +1,33 @@
+#include "TransactionRow.hpp"
+
+#include "JsonWriter.hpp"
+#include "PgBinary.hpp"
+
+TransactionRow TransactionRow::decode(const PGresult* r, int row) {
+  TransactionRow t;
+  t.id = PgBinary::int8(r, row, 0);
+  t.type = PgBinary::text(r, row, 1);
+  t.amountCents = PgBinary::numericCents(r, row, 2);
+  t.currency = PgBinary::text(r, row, 3);
+  t.date = PgBinary::date(r, row, 4);
+  t.category = PgBinary::text(r, row, 5);
+  t.title = PgBinary::text(r, row, 6);
+  t.note = PgBinary::text(r, row, 7);
+  return t;
+}
+
+void TransactionRow::writeJson(JsonWriter& w) const {
+  char day[11];
+  PgBinary::formatDate(date, day);
+  w.beginObject()
+      .key("id").value(id)
+      .key("type").value(type)
+      .key("amount").cents(amountCents)
+      .key("amountCents").value(amountCents)
+      .key("currency").value(currency)
+      .key("date").value(std::string_view(day, 10))
+      .key("category").value(category)
+      .key("title").value(title)
+      .key("note").value(note)
+      .endObject();
+}
@@ -0,0 +1,28 @@
+#pragma once
+#include <cstdint>
+#include <string_view>
+
+#include <libpq-fe.h>
+
+class JsonWriter;
+
+// One row of the transaction listing, decoded from a binary-format result
+// with columns id,type,amount,currency,tx_date,category,title,note (the
+// shape of TransactionSearch queries). Text fields are views into the
+// PGresult and are only valid until it is cleared.
+struct TransactionRow {
+  int64_t id = 0;
+  std::string_view type;
+  int64_t amountCents = 0;
+  std::string_view currency;
+  int32_t date = 0;  // days since 2000-01-01, see PgBinary::formatDate
+  std::string_view category;
+  std::string_view title;
+  std::string_view note;
+
+  static TransactionRow decode(const PGresult* r, int row);
+
+  // The API's JSON object for a transaction. `amount` keeps its
+  // JSON-number form for existing clients; `amountCents` is exact.
+  void writeJson(JsonWriter& w) const;
+};
@@ -0,0 +1,305 @@
+#include "TransactionSearch.hpp"
+
+#include "PgBinary.hpp"
+#include "nlohmann/json.hpp"
+
+#include <cctype>
+#include <cstdio>
+
+namespace TransactionSearch {
+
+namespace {
+
+// Bits of the combination mask, which also names the prepared statement.
+enum : unsigned {
+  kType = 1,
+  kStart = 2,
+  kEnd = 4,
+  kCategory = 8,
+  kMin = 16,
+  kMax = 32,
+  kAfter = 64,
+  kOffset = 128,
+  kQuery = 256,
+};
+
+// Everything but kOffset narrows the rows; those need an index condition.
+constexpr unsigned kFilters = kType | kStart | kEnd | kCategory | kMin | kMax | kAfter | kQuery;
+
+// checkIndexes() fixture: kSeedUsers users with kSeedRowsPerUser rows
+// each, spread over six years, eight categories and a skewed type split,
+// so the planner costs the real alternatives instead of an empty table.
+constexpr int kSeedUsers = 50;
+constexpr int kSeedRowsPerUser = 2000;
+
+// Terms past this many add little but cost a GIN lookup each.
+constexpr int kMaxQueryWords = 8;
+
+bool descending(Sort s) { return s == Sort::DateDesc || s == Sort::AmountDesc; }
+
+// Collects every "Index Cond" in a JSON plan, and whether it sorts or
+// scans the table sequentially anywhere.
+struct PlanShape {
+  std::string indexConds;
+  bool sorts = false;
+  bool seqScan = false;
+};
+
+void walk(const nlohmann::json& node, PlanShape& shape) {
+  const std::string type = node.value("Node Type", "");
+  if (type == "Sort" || type == "Incremental Sort") shape.sorts = true;
+  if (type == "Seq Scan") shape.seqScan = true;
+  if (node.contains("Index Cond")) {
+    shape.indexConds += node["Index Cond"].get<std::string>();
+    shape.indexConds += ' ';
+  }
+  if (node.contains("Plans")) {
+    for (const auto& child : node["Plans"]) walk(child, shape);
+  }
+}
+
+Query& named(Query& q, Sort sort, unsigned mask) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "search_tx_%d_%03x", static_cast<int>(sort), mask);
+  q.name = name;
+  return q;
+}
+
+}  // namespace
+
+std::optional<Sort> parseSort(const std::string& s) {
+  if (s == "date_desc") return Sort::DateDesc;
+  if (s == "date_asc") return Sort::DateAsc;
+  if (s == "amount_desc") return Sort::AmountDesc;
+  if (s == "amount_asc") return Sort::AmountAsc;
+  if (s == "relevance") return Sort::Relevance;
+  return std::nullopt;
+}
+
+Cursor::Key cursorKey(Sort s) {
+  if (s == Sort::Relevance) return Cursor::Key::Offset;
+  return s == Sort::AmountDesc || s == Sort::AmountAsc ? Cursor::Key::Amount
+                                                       : Cursor::Key::Date;
+}
+
+std::string tsQuery(const std::string& q) {
+  std::string out, word;
+  int words = 0;
+  auto flush = [&]() {
+    if (!word.empty() && words++ < kMaxQueryWords) {
+      if (!out.empty()) out += " & ";
+      out += word;
+      out += ":*";
+    }
+    word.clear();
+  };
+  for (unsigned char c : q) {
+    // Bytes >= 0x80 are UTF-8 letters as far as we care.
+    if (std::isalnum(c) || c >= 0x80) word += static_cast<char>(std::tolower(c));
+    else flush();
+  }
+  flush();
+  return out;
+}
+
+Query build(long userId, const Filters& f) {
+  Query q;
+  unsigned mask = 0;
+  auto param = [&](std::string v) {
+    q.params.push_back(std::move(v));
+    return "$" + std::to_string(q.params.size());
+  };
+
+  // Amount bounds and keys travel as integer cents; dividing the
+  // parameter (not the column) keeps the predicate indexable.
+  std::string where = "WHERE user_id=" + param(std::to_string(userId));
+  if (!f.type.empty()) {
+    mask |= kType;
+    where += " AND type=" + param(f.type);
+  }
+  if (!f.startDate.empty()) {
+    mask |= kStart;
+    where += " AND tx_date >= " + param(f.startDate) + "::date";
+  }
+  if (!f.endDate.empty()) {
+    mask |= kEnd;
+    where += " AND tx_date <= " + param(f.endDate) + "::date";
+  }
+  if (!f.category.empty()) {
+    mask |= kCategory;
+    where += " AND category=" + param(f.category);
+  }
+  if (f.minAmountCents >= 0) {
+    mask |= kMin;
+    where += " AND amount >= " + param(std::to_string(f.minAmountCents)) +
+             "::bigint / 100.0";
+  }
+  if (f.maxAmountCents >= 0) {
+    mask |= kMax;
+    where += " AND amount <= " + param(std::to_string(f.maxAmountCents)) +
+             "::bigint / 100.0";
+  }
+  // Prefix terms through the tsvector index, or a close trigram match on
+  // the title ("starbuks") through the trigram index.
+  std::string rank;
+  if (!f.q.empty()) {
+    mask |= kQuery;
+    const std::string terms = "to_tsquery('simple', " + param(tsQuery(f.q)) + ")";
+    const std::string text = param(f.q);
+    where += " AND (search @@ " + terms + " OR " + text + " <% title)";
+    rank = "ts_rank(search, " + terms + ") + word_similarity(" + text + ", title)";
+  }
+
+  const char* columns =
+      "SELECT id,type,amount,currency,tx_date,category,title,COALESCE(note,'') "
+      "FROM transactions ";
+  if (f.sort == Sort::Relevance) {
+    // Ranks are floats computed per query, so pages go by offset; the
+    // cursor just carries it.
+    q.sql = columns + where + " ORDER BY " + rank + " DESC, id DESC LIMIT " +
+            param(std::to_string(f.pageSize + 1));
+    const int64_t offset = f.after ? f.after->value
+                                   : static_cast<int64_t>(f.page - 1) * f.pageSize;
+    if (offset > 0) {
+      mask |= kOffset;
+      q.sql += " OFFSET " + param(std::to_string(offset));
+    }
+    return named(q, f.sort, mask);
+  }
+
+  const bool desc = descending(f.sort);
+  const bool byAmount = cursorKey(f.sort) == Cursor::Key::Amount;
+  if (f.after) {
+    mask |= kAfter;
+    std::string key;
+    if (byAmount) {
+      key = param(std::to_string(f.after->value)) + "::bigint / 100.0";
+    } else {
+      char day[11];
+      PgBinary::formatDate(static_cast<int32_t>(f.after->value), day);
+      key = param(day) + "::date";
+    }
+    where += std::string(byAmount ? " AND (amount, id) " : " AND (tx_date, id) ") +
+             (desc ? "< (" : "> (") + key + ", " +
+             param(std::to_string(f.after->id)) + "::bigint)";
+  }
+
+  const char* dir = desc ? " DESC" : " ASC";
+  q.sql = columns + where +
+          " ORDER BY " + (byAmount ? "amount" : "tx_date") + dir + ", id" + dir +
+          " LIMIT " + param(std::to_string(f.pageSize + 1));
+  if (!f.after && f.page > 1) {
+    mask |= kOffset;
+    q.sql += " OFFSET " +
+             param(std::to_string(static_cast<int64_t>(f.page - 1) * f.pageSize));
+  }
+
+  return named(q, f.sort, mask);
+}
+
+std::vector<std::string> checkIndexes(Db& db) {
+  std::vector<std::string> failures;
+  PGconn* c = db.conn();
+  const auto run = [&](const std::string& sql) {
+    PGresult* r = PQexec(c, sql.c_str());
+    const ExecStatusType st = r ? PQresultStatus(r) : PGRES_FATAL_ERROR;
+    PQclear(r);
+    if (st == PGRES_COMMAND_OK || st == PGRES_TUPLES_OK) return true;
+    failures.push_back(std::string("seeding: ") + PQerrorMessage(c));
+    return false;
+  };
+
+  // Seeded and analyzed inside the transaction, so nothing of it
+  // (statistics included) survives the ROLLBACK.
+  if (!run("BEGIN")) return failures;
+  const std::string users =
+      "SELECT id FROM users WHERE email LIKE 'index-check-%@flowfund.invalid'";
+  if (!run("INSERT INTO users (name, email, password_hash) "
+           "SELECT 'index check', 'index-check-' || g || '@flowfund.invalid', '-' "
+           "FROM generate_series(1, " + std::to_string(kSeedUsers) + ") g "
+           "ON CONFLICT (email) DO NOTHING") ||
+      !run("INSERT INTO transactions (user_id, type, amount, tx_date, category, title, note) "
+           "SELECT u.id, CASE WHEN g % 5 = 0 THEN 'INCOME' ELSE 'EXPENSE' END, "
+           "((g * 7919) % 200000) / 100.0 + 0.01, DATE '2020-01-01' + g % 2190, "
+           "(ARRAY['Food','Rent','Travel','Shopping','Bills','Health','Salary','Fun'])"
+           "[1 + g % 8], "
+           "(ARRAY['Coffee shop','Grocery store','Airline','Pharmacy','Payroll',"
+           "'Cinema','Utility co','Bookstore'])[1 + (g / 8) % 8] || ' #' || g % 97, "
+           "CASE WHEN g % 3 = 0 THEN 'note ' || g END "
+           "FROM (" + users + ") u, generate_series(1, " +
+           std::to_string(kSeedRowsPerUser) + ") g") ||
+      !run("ANALYZE users, transactions")) {
+    PQclear(PQexec(c, "ROLLBACK"));
+    return failures;
+  }
+  PGresult* who = PQexec(c, (users + " ORDER BY id LIMIT 1").c_str());
+  const long userId = PQresultStatus(who) == PGRES_TUPLES_OK && PQntuples(who) == 1
+                          ? std::stol(PQgetvalue(who, 0, 0))
+                          : 0;
+  PQclear(who);
+  if (!userId) {
+    failures.push_back("seeding: fixture user not found");
+    PQclear(PQexec(c, "ROLLBACK"));
+    return failures;
+  }
+
+  const Sort sorts[] = {Sort::DateDesc, Sort::DateAsc, Sort::AmountDesc,
+                        Sort::AmountAsc, Sort::Relevance};
+  for (Sort sort : sorts) {
+    for (unsigned mask = 0; mask < 2 * kQuery; mask++) {
+      if ((mask & kAfter) && (mask & kOffset)) continue;  // never combined
+      if (sort == Sort::Relevance && (!(mask & kQuery) || (mask & kAfter))) {
+        continue;  // relevance needs q and pages by offset
+      }
+
+      Filters f;
+      f.sort = sort;
+      if (mask & kType) f.type = "EXPENSE";
+      if (mask & kStart) f.startDate = "2024-01-01";
+      if (mask & kEnd) f.endDate = "2024-12-31";
+      if (mask & kCategory) f.category = "Food";
+      if (mask & kMin) f.minAmountCents = 100;
+      if (mask & kMax) f.maxAmountCents = 100000;
+      if (mask & kAfter) f.after = Cursor::Position{cursorKey(sort), 8766, 1000};
+      if (mask & kOffset) f.page = 3;
+      if (mask & kQuery) f.q = "coffee";
+      const Query q = build(userId, f);
+
+      std::vector<const char*> params;
+      for (const auto& p : q.params) params.push_back(p.c_str());
+      const std::string explain = "EXPLAIN (FORMAT JSON) " + q.sql;
+      PGresult* r = PQexecParams(c, explain.c_str(), static_cast<int>(params.size()),
+                                 nullptr, params.data(), nullptr, nullptr, 0);
+      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
+        failures.push_back(q.name + ": " + PQerrorMessage(c));
+        if (r) PQclear(r);
+        continue;
+      }
+      PlanShape shape;
+      walk(nlohmann::json::parse(PQgetvalue(r, 0, 0))[0]["Plan"], shape);
+      PQclear(r);
+
+      // Index-driven means: with filters, an index condition on at least
+      // one filtered column (a condition on user_id alone leaves the
+      // filters to be checked row by row); without, the index yields the
+      // requested order so the LIMIT stops the scan early.
+      const auto uses = [&](const char* col) {
+        return shape.indexConds.find(col) != std::string::npos;
+      };
+      const bool filtered = ((mask & kType) && uses("(type = ")) ||
+                            ((mask & (kStart | kEnd)) && uses("tx_date")) ||
+                            ((mask & kCategory) && uses("(category = ")) ||
+                            ((mask & (kMin | kMax)) && uses("amount")) ||
+                            ((mask & kAfter) && uses("ROW(")) ||
+                            ((mask & kQuery) && (uses("search") || uses("title")));
+      if (shape.seqScan || ((mask & kFilters) ? !filtered : shape.sorts)) {
+        failures.push_back(q.name + ": " + q.sql);
+      }
+    }
+  }
+
+  PQclear(PQexec(c, "ROLLBACK"));
+  return failures;
+}
+
+}  // namespace TransactionSearch
@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Cursor.hpp"
+#include "Db.hpp"
+
+// Filtered, sorted listing for GET /transactions. The filters mirror
+// repo::TransactionFilters (same names and meaning); only the predicates
+// that are set make it into the SQL, so every combination stays a range
+// scan on one of the idx_transactions_user_* indexes. A text query (`q`)
+// goes through the GIN indexes over the generated `search` column and the
+// title trigrams instead.
+namespace TransactionSearch {
+
+// Relevance is only valid with `q`, and is the default there.
+enum class Sort { DateDesc, DateAsc, AmountDesc, AmountAsc, Relevance };
+
+struct Filters {
+  std::string type;       // INCOME / EXPENSE, empty for both
+  std::string startDate;  // inclusive YYYY-MM-DD, empty for open
+  std::string endDate;    // inclusive YYYY-MM-DD, empty for open
+  std::string category;   // exact match, empty for all
+  int64_t minAmountCents = -1;  // -1: no bound
+  int64_t maxAmountCents = -1;
+  std::string q;  // free text over title, note and category; empty for none
+  Sort sort = Sort::DateDesc;
+
+  int pageSize = 200;
+  int page = 1;  // OFFSET paging; ignored when `after` is set
+  std::optional<Cursor::Position> after;
+};
+
+// "date_desc", ..., "relevance"; nullopt for anything else.
+std::optional<Sort> parseSort(const std::string& s);
+
+// Keyset key the sort walks; `after` must use the same one.
+Cursor::Key cursorKey(Sort s);
+
+// `q` as a to_tsquery('simple') expression: each run of letters/digits
+// becomes a prefix term ("cof:* & shop:*"), punctuation is dropped so
+// user input can never be tsquery syntax. Empty if `q` has no words.
+std::string tsQuery(const std::string& q);
+
+// SQL plus text parameters for one filter combination. `name` is stable
+// per combination, so each one is prepared once per connection.
+struct Query {
+  std::string name;
+  std::string sql;
+  std::vector<std::string> params;
+};
+
+// Selects the listing columns (see TransactionRow) with LIMIT
+// pageSize + 1, so the caller can tell whether a next page exists.
+Query build(long userId, const Filters& f);
+
+// Seeds a representative data set inside a transaction, runs EXPLAIN for
+// every filter/sort/cursor combination and reports the ones whose plan
+// scans sequentially, has no index condition on any filtered column
+// (only user_id), or sorts an unfiltered listing. Rolls back. Empty means
+// every combination is index-driven.
+std::vector<std::string> checkIndexes(Db& db);
+
+}  // namespace TransactionSearch
@@ -0,0 +1,106 @@
+#include "Money.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace utils {
+
+namespace {
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+}  // namespace
+
+Money::Money(int64_t cents, std::string_view currency) : m_cents(cents) {
+  m_len = std::min(currency.size(), sizeof(m_currency) - 1);
+  std::memcpy(m_currency, currency.data(), m_len);
+  m_currency[m_len] = '\0';
+}
+
+std::optional<Money> Money::parse(std::string_view amount, std::string_view currency) {
+  int64_t cents = 0;
+  if (!parseCents(amount, cents)) return std::nullopt;
+  return Money(cents, currency);
+}
+
+std::optional<Money> Money::fromNumber(double amount, std::string_view currency) {
+  if (!std::isfinite(amount)) return std::nullopt;
+  const double cents = std::round(amount * 100);
+  if (std::fabs(cents) > static_cast<double>(kMaxCents)) return std::nullopt;
+  return Money(static_cast<int64_t>(cents), currency);
+}
+
+Money& Money::operator+=(const Money& o) {
+  if (currency() != o.currency()) throw std::invalid_argument("currency mismatch");
+  m_cents += o.m_cents;
+  return *this;
+}
+
+Money& Money::operator-=(const Money& o) {
+  if (currency() != o.currency()) throw std::invalid_argument("currency mismatch");
+  m_cents -= o.m_cents;
+  return *this;
+}
+
+std::string Money::amountString() const { return centsToAmountString(m_cents); }
+
+bool parseCents(std::string_view s, int64_t& out) {
+  while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+  while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+  bool neg = false;
+  if (!s.empty() && (s[0] == '-' || s[0] == '+')) {
+    neg = s[0] == '-';
+    s.remove_prefix(1);
+  }
+  const size_t dot = s.find('.');
+  const std::string_view whole = s.substr(0, dot);
+  const std::string_view frac =
+      dot == std::string_view::npos ? std::string_view() : s.substr(dot + 1);
+  if (whole.empty() && frac.empty()) return false;
+  if (whole.size() > 10 || frac.size() > 2) return false;
+
+  int64_t v = 0;
+  for (char c : whole) {
+    if (c < '0' || c > '9') return false;
+    v = v * 10 + (c - '0');
+  }
+  v *= 100;
+  int64_t scale = 10;
+  for (char c : frac) {
+    if (c < '0' || c > '9') return false;
+    v += (c - '0') * scale;
+    scale /= 10;
+  }
+  out = neg ? -v : v;
+  return true;
+}
+
+size_t formatCents(int64_t cents, char* out) {
+  char* p = out;
+  // Work on the magnitude as unsigned so INT64_MIN does not overflow.
+  const uint64_t mag =
+      cents < 0 ? 0 - static_cast<uint64_t>(cents) : static_cast<uint64_t>(cents);
+  if (cents < 0) *p++ = '-';
+  p = std::to_chars(p, out + Money::kMaxChars, mag / 100).ptr;
+  const unsigned frac = static_cast<unsigned>(mag % 100);
+  *p++ = '.';
+  *p++ = static_cast<char>('0' + frac / 10);
+  *p++ = static_cast<char>('0' + frac % 10);
+  return static_cast<size_t>(p - out);
+}
+
+int64_t parseAmountToCents(const std::string& amount) {
+  int64_t cents = 0;
+  if (!parseCents(amount, cents)) throw std::invalid_argument("invalid amount: " + amount);
+  return cents;
+}
+
+std::string centsToAmountString(int64_t cents) {
+  char buf[Money::kMaxChars];
+  return std::string(buf, formatCents(cents, buf));
+}
+
+}  // namespace utils
@@ -1,12 +1,66 @@
 #pragma once
 
+#include <cstddef>
 #include <cstdint>
+#include <optional>
 #include <string>
+#include <string_view>
 
 namespace utils {
 
+// An amount in integer cents plus its ISO 4217 code. Amounts are parsed
+// into cents at the edge (JSON, CSV) and only formatted back on the way
+// out, so sums are integer adds and never drift.
+class Money {
+ public:
+  // Longest formatCents output: "-92233720368547758.08".
+  static constexpr size_t kMaxChars = 21;
+  // NUMERIC(12,2): ten integer digits.
+  static constexpr int64_t kMaxCents = 999999999999;
+
+  constexpr Money() = default;
+  Money(int64_t cents, std::string_view currency);
+
+  int64_t cents() const { return m_cents; }
+  std::string_view currency() const { return {m_currency, m_len}; }
+
+  // Exact decimal text, e.g. "-12.5" -> -1250 (see parseCents).
+  static std::optional<Money> parse(std::string_view amount, std::string_view currency);
+
+  // A JSON number, rounded to the nearest cent. nullopt if it is not
+  // finite or does not fit kMaxCents.
+  static std::optional<Money> fromNumber(double amount, std::string_view currency);
+
+  // Same currency only; throws std::invalid_argument otherwise.
+  Money& operator+=(const Money& o);
+  Money& operator-=(const Money& o);
+
+  // "19.99"; always two decimals.
+  std::string amountString() const;
+
+ private:
+  int64_t m_cents = 0;
+  char m_currency[8] = "CAD";
+  size_t m_len = 3;
+};
+
+// Plain decimal with at most two fractional digits and ten integer
+// digits, optional sign, surrounding spaces ignored; no exponents or
+// separators. Does not allocate.
+bool parseCents(std::string_view s, int64_t& out);
+
+// Writes `cents` as "-19.99" into `out` (at least Money::kMaxChars bytes,
+// not NUL-terminated). Returns the length.
+size_t formatCents(int64_t cents, char* out);
+
+inline void appendCents(std::string& out, int64_t cents) {
+  char buf[Money::kMaxChars];
+  out.append(buf, formatCents(cents, buf));
+}
+
 // Convert decimal string "19.99" -> 1999 cents (CAD) etc.
 // We'll keep cents in DB to avoid floating point bugs.
+// Throws std::invalid_argument if invalid.
 int64_t parseAmountToCents(const std::string& amount);
 
 // Convert cents -> "19.99"
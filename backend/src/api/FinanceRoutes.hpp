@@ -20,9 +20,10 @@ inline void registerFinanceRoutes(httplib::Server& s, FinanceService& f) {
     });
 
     s.Get("/summary",[&](auto&, auto& res){
-        json j={{"income",f.totalIncome()},
-                {"expense",f.totalExpense()},
-                {"balance",f.balance()}};
+        auto t=f.summary();
+        json j={{"income",t.incomeCents/100.0},
+                {"expense",t.expenseCents/100.0},
+                {"balance",(t.incomeCents-t.expenseCents)/100.0}};
         res.set_content(j.dump(),"application/json");
     });
 }
@@ -3,12 +3,27 @@
 #include <sstream>
 #include <stdexcept>
 
+CachedStatement::~CachedStatement() {
+    sqlite3_reset(stmt);
+    sqlite3_clear_bindings(stmt);
+}
+
 Database::Database(const std::string& path) {
-    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK)
+    if (sqlite3_open(path.c_str(), &db) != SQLITE_OK) {
+        sqlite3_close(db);
         throw std::runtime_error("DB open failed");
+    }
+    // journal_mode stays "memory" for :memory: databases; that is fine.
+    sqlite3_exec(db, "PRAGMA journal_mode=WAL", nullptr, nullptr, nullptr);
+    sqlite3_exec(db, "PRAGMA synchronous=NORMAL", nullptr, nullptr, nullptr);
+    sqlite3_busy_timeout(db, 5000);
+}
+
+Database::~Database() {
+    for (auto& entry : statements) sqlite3_finalize(entry.second);
+    sqlite3_close(db);
 }
 
-Database::~Database() { sqlite3_close(db); }
 sqlite3* Database::get() { return db; }
 
 void Database::runMigrations(const std::string& file) {
@@ -18,3 +33,25 @@ void Database::runMigrations(const std::string& file) {
     char* err = nullptr;
     sqlite3_exec(db, ss.str().c_str(), nullptr, nullptr, &err);
 }
+
+CachedStatement Database::prepare(const std::string& sql) {
+    auto it = statements.find(sql);
+    if (it == statements.end()) {
+        sqlite3_stmt* stmt = nullptr;
+        if (sqlite3_prepare_v3(db, sql.c_str(), -1, SQLITE_PREPARE_PERSISTENT,
+                               &stmt, nullptr) != SQLITE_OK) {
+            throw std::runtime_error(std::string("prepare failed: ") + sqlite3_errmsg(db));
+        }
+        it = statements.emplace(sql, stmt).first;
+    }
+    return CachedStatement(it->second);
+}
+
+void Database::exec(const char* sql) {
+    char* err = nullptr;
+    if (sqlite3_exec(db, sql, nullptr, nullptr, &err) != SQLITE_OK) {
+        std::string msg = err ? err : sqlite3_errmsg(db);
+        sqlite3_free(err);
+        throw std::runtime_error(std::string(sql) + " failed: " + msg);
+    }
+}
@@ -1,12 +1,40 @@
 #pragma once
 #include <sqlite3.h>
 #include <string>
+#include <unordered_map>
+
+// A statement borrowed from Database's cache. Reset, with its bindings
+// cleared, when it goes out of scope so it is ready for the next caller
+// and does not hold a read transaction open.
+class CachedStatement {
+    sqlite3_stmt* stmt;
+public:
+    explicit CachedStatement(sqlite3_stmt* s) : stmt(s) {}
+    ~CachedStatement();
+    CachedStatement(const CachedStatement&) = delete;
+    CachedStatement& operator=(const CachedStatement&) = delete;
+    operator sqlite3_stmt*() const { return stmt; }
+};
 
 class Database {
     sqlite3* db;
+    std::unordered_map<std::string, sqlite3_stmt*> statements;
 public:
+    // Opens in WAL mode with synchronous=NORMAL: commits append to the
+    // log without an fsync each, and readers do not block the writer.
     explicit Database(const std::string& path);
     ~Database();
+    Database(const Database&) = delete;
+    Database& operator=(const Database&) = delete;
+
     sqlite3* get();
     void runMigrations(const std::string& file);
+
+    // Prepared on first use and kept for the life of the connection.
+    CachedStatement prepare(const std::string& sql);
+
+    void exec(const char* sql);
+    void begin() { exec("BEGIN"); }
+    void commit() { exec("COMMIT"); }
+    void rollback() { exec("ROLLBACK"); }
 };
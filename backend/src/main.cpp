@@ -1,24 +1,65 @@
 #include "httplib.h"
 #include "nlohmann/json.hpp"
 
+#include "AsyncDb.hpp"
+#include "Balances.hpp"
+#include "BoundedExecutor.hpp"
+#include "BulkImport.hpp"
+#include "Compression.hpp"
+#include "ConcurrencyLimiter.hpp"
+#include "CoreStore.hpp"
+#include "CorsPolicy.hpp"
+#include "Cursor.hpp"
+#include "DataVersions.hpp"
 #include "Db.hpp"
+#include "DbPool.hpp"
 #include "Env.hpp"
+#include "JsonWriter.hpp"
 #include "Jwt.hpp"
+#include "JwtCache.hpp"
+#include "Metrics.hpp"
 #include "Password.hpp"
+#include "PgBinary.hpp"
+#include "ResponseCache.hpp"
+#include "Rollup.hpp"
+#ifdef FLOWFUND_SQLITE
+#include "SqliteStore.hpp"
+#endif
+#include "Statements.hpp"
+#include "TransactionBatch.hpp"
+#include "TransactionExport.hpp"
+#include "TransactionRow.hpp"
+#include "TransactionSearch.hpp"
+#include "Utils/Money.hpp"
 
 #include <algorithm>
 #include <cctype>
+#include <chrono>
+#include <cstring>
+#include <ctime>
 #include <fstream>
+#include <functional>
 #include <iostream>
 #include <libpq-fe.h>
+#include <memory>
+#include <optional>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
 #include <vector>
 
 using json = nlohmann::json;
 
 // ---------------------- Utilities ----------------------
 
+// GET /transactions page size: `limit` query param, newest first.
+static constexpr int kDefaultPageSize = 200;
+static constexpr int kMaxPageSize = 200;
+// `q` search text; longer input is not a merchant name.
+static constexpr size_t kMaxQueryLength = 200;
+
 static std::string readFile(const std::string& path) {
   std::ifstream f(path);
   if (!f.is_open()) return "";
@@ -32,6 +73,7 @@ static void clearRes(PGresult* r) {
 }
 
 static bool parseJsonBody(const httplib::Request& req, json& out) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Json);
   out = json::parse(req.body, nullptr, false);
   return !out.is_discarded();
 }
@@ -56,15 +98,20 @@ static std::string trimCopy(std::string s) {
   return s;
 }
 
-static std::vector<std::string> splitCsv(const std::string& s) {
-  std::vector<std::string> out;
-  std::stringstream ss(s);
-  std::string item;
-  while (std::getline(ss, item, ',')) {
-    item = trimCopy(item);
-    if (!item.empty()) out.push_back(item);
+static int parseIntOr(const std::string& s, int def) {
+  try {
+    size_t used = 0;
+    int v = std::stoi(s, &used);
+    return used == s.size() ? v : def;
+  } catch (...) {
+    return def;
   }
-  return out;
+}
+
+// Amounts are summed and carried as integer cents; they only become a
+// JSON number (e.g. 19.99) on the way out, for existing clients.
+static double centsToAmount(int64_t cents) {
+  return static_cast<double>(cents) / 100.0;
 }
 
 static std::string getHeaderOrEmpty(const httplib::Request& req,
@@ -74,52 +121,61 @@ static std::string getHeaderOrEmpty(const httplib::Request& req,
   return it->second;
 }
 
-// ---------------------- CORS ----------------------
-//
-// CORS_ORIGIN can be:
-//   - "*" (allow any origin; we echo request Origin when present for best browser compatibility)
-//   - a single origin: "https://hetansh2744.github.io"
-//   - multiple comma-separated: "https://a.com,https://b.com"
-//
-// IMPORTANT: We do NOT use cookies here, so we do not set Allow-Credentials.
-
-static std::string resolveCorsOrigin(const httplib::Request& req,
-                                    const std::string& corsOriginEnv) {
-  const std::string reqOrigin = getHeaderOrEmpty(req, "Origin");
-  if (corsOriginEnv.empty()) return "";  // disable CORS
-
-  // If env is "*", best practice is to echo request Origin if present.
-  if (corsOriginEnv == "*") {
-    if (!reqOrigin.empty()) return reqOrigin;
-    return "*";
-  }
-
-  // If env is a list, allow if exact match.
-  const auto allowed = splitCsv(corsOriginEnv);
-  if (allowed.empty()) return "";
+// Content-Encoding for JSON bodies sent to this client.
+static Compression::Encoding acceptedEncoding(const httplib::Request& req) {
+  return Compression::negotiate(getHeaderOrEmpty(req, "Accept-Encoding"));
+}
 
-  for (const auto& a : allowed) {
-    if (a == reqOrigin) return reqOrigin;
-  }
+// ETag variant and response-cache key: the target plus the encoding, since
+// gzip and identity bodies are different representations.
+static std::string encodedTarget(const httplib::Request& req,
+                                 Compression::Encoding enc) {
+  return req.target + '|' + Compression::token(enc);
+}
 
-  // Not allowed
-  return "";
+// ---------------------- CORS ----------------------
+//
+// The policy itself (CORS_ORIGIN parsing and matching) lives in
+// CorsPolicy; these helpers only move header values in and out.
+
+// Allowed Access-Control-Allow-Origin value for this request, or empty.
+// The view points into the request headers or the policy.
+static std::string_view resolveCorsOrigin(const httplib::Request& req,
+                                          const CorsPolicy& cors) {
+  if (!cors.enabled()) return {};
+  auto it = req.headers.find("Origin");
+  return cors.allowOrigin(it == req.headers.end() ? std::string_view()
+                                                  : std::string_view(it->second));
 }
 
-static void addCors(httplib::Response& res, const std::string& origin) {
+static void addCors(httplib::Response& res, std::string_view origin) {
   if (origin.empty()) return;
 
-  res.set_header("Access-Control-Allow-Origin", origin.c_str());
+  res.set_header("Access-Control-Allow-Origin", std::string(origin));
   res.set_header("Vary", "Origin");  // important when echoing dynamic origin
+}
 
-  res.set_header("Access-Control-Allow-Headers", "Content-Type, Authorization");
-  res.set_header("Access-Control-Allow-Methods",
-                 "GET, POST, PUT, PATCH, DELETE, OPTIONS");
-  res.set_header("Access-Control-Max-Age", "86400");
+// Answers every OPTIONS request before routing; the preflight-only
+// headers are not repeated on ordinary responses.
+static httplib::Server::HandlerResponse preflight(const httplib::Request& req,
+                                                  httplib::Response& res,
+                                                  const CorsPolicy& cors) {
+  if (req.method != "OPTIONS") return httplib::Server::HandlerResponse::Unhandled;
+
+  const std::string_view origin = resolveCorsOrigin(req, cors);
+  if (!origin.empty()) {
+    addCors(res, origin);
+    res.set_header("Access-Control-Allow-Headers", cors.allowHeaders());
+    res.set_header("Access-Control-Allow-Methods", cors.allowMethods());
+    res.set_header("Access-Control-Max-Age", cors.maxAge());
+  }
+  res.status = 204;
+  return httplib::Server::HandlerResponse::Handled;
 }
 
 static void jsonOk(httplib::Response& res, const json& body,
-                   const std::string& origin) {
+                   std::string_view origin) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Json);
   addCors(res, origin);
   res.status = 200;
   res.set_content(body.dump(), "application/json");
@@ -127,18 +183,417 @@ static void jsonOk(httplib::Response& res, const json& body,
 
 static void jsonError(httplib::Response& res, int status,
                       const std::string& code, const std::string& msg,
-                      const std::string& origin) {
+                      std::string_view origin) {
   addCors(res, origin);
   res.status = status;
   res.set_content(json({{"error", {{"code", code}, {"message", msg}}}}).dump(),
                   "application/json");
 }
 
+static void setEtag(httplib::Response& res, const std::string& etag) {
+  res.set_header("ETag", etag);
+  // The browser keeps the body but revalidates on every use, which is
+  // what turns app.js polling into 304s; shared caches must not store it.
+  res.set_header("Cache-Control", "private, no-cache");
+  // The body is per user; a cache keyed on the URL must not reuse it
+  // across bearer tokens.
+  res.set_header("Vary", "Authorization");
+}
+
+// Conditional GET: answers 304 when If-None-Match already names `etag`.
+static bool notModified(const httplib::Request& req, httplib::Response& res,
+                        const std::string& etag, std::string_view origin) {
+  const std::string inm = getHeaderOrEmpty(req, "If-None-Match");
+  if (inm.empty() || !DataVersions::matches(inm, etag)) return false;
+  addCors(res, origin);
+  setEtag(res, etag);
+  res.status = 304;
+  return true;
+}
+
+static void setEncoding(httplib::Response& res, Compression::Encoding enc) {
+  res.set_header("Vary", "Accept-Encoding");
+  if (enc != Compression::Encoding::Identity) {
+    res.set_header("Content-Encoding", Compression::token(enc));
+  }
+}
+
+// 200 with a JSON body, compressed as `enc` when it is large enough to be
+// worth it (see Compression).
+static void sendJson(httplib::Response& res, std::string body,
+                     Compression::Encoding enc, std::string_view origin) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Json);
+  addCors(res, origin);
+  res.status = 200;
+  setEncoding(res, Compression::apply(enc, body));
+  res.set_content(std::move(body), "application/json");
+}
+
+// 200 with a shared body (see ResponseCache), streamed from the buffer
+// rather than copied into the response.
+static void sendCached(httplib::Response& res, const ResponseCache::Body& body,
+                       const std::string& etag, std::string_view origin) {
+  addCors(res, origin);
+  setEtag(res, etag);
+  setEncoding(res, body->encoding);
+  res.status = 200;
+  res.set_content_provider(
+      body->bytes.size(), "application/json",
+      [body](size_t offset, size_t length, httplib::DataSink& sink) {
+        const std::string& bytes = body->bytes;
+        return sink.write(bytes.data() + offset, std::min(length, bytes.size() - offset));
+      });
+}
+
+// 400 for a bulk upload with invalid rows; nothing was imported.
+static void bulkRowErrors(httplib::Response& res, size_t errorCount,
+                          const std::vector<BulkImport::RowError>& rows,
+                          std::string_view origin) {
+  std::string body;
+  JsonWriter w(body);
+  w.beginObject()
+      .key("error").beginObject()
+      .key("code").value("VALIDATION_ERROR")
+      .key("message").value("Some rows are invalid; nothing was imported")
+      .endObject()
+      .key("errorCount").value(static_cast<int64_t>(errorCount))
+      .key("rows").beginArray();
+  for (const auto& e : rows) {
+    w.beginObject()
+        .key("row").value(static_cast<int64_t>(e.row))
+        .key("message").value(e.message)
+        .endObject();
+  }
+  w.endArray().endObject();
+
+  addCors(res, origin);
+  res.status = 400;
+  res.set_content(std::move(body), "application/json");
+}
+
+// Error for POST /transactions/batch naming the op (0-based) that failed;
+// none of the batch was applied.
+static void batchError(httplib::Response& res, int status, const std::string& code,
+                       const TransactionBatch::Failure& f, std::string_view origin) {
+  std::string body;
+  JsonWriter w(body);
+  w.beginObject()
+      .key("error").beginObject()
+      .key("code").value(code)
+      .key("message").value(f.message)
+      .endObject()
+      .key("index").value(static_cast<int64_t>(f.index))
+      .endObject();
+
+  addCors(res, origin);
+  res.status = status;
+  res.set_content(std::move(body), "application/json");
+}
+
+// GET /transactions query parameters, named after repo::TransactionFilters:
+// type, startDate, endDate, category (or categoryId), minAmountCents,
+// maxAmountCents, sort, page and pageSize (or limit). The cursor is read
+// separately. Returns a validation message, empty when all is well.
+static std::string readListFilters(const httplib::Request& req,
+                                   TransactionSearch::Filters& f) {
+  auto param = [&](const char* key) {
+    return req.has_param(key) ? req.get_param_value(key) : std::string();
+  };
+  auto cents = [&](const char* key, int64_t& out) {
+    const std::string v = param(key);
+    if (v.empty()) return true;
+    try {
+      size_t used = 0;
+      out = std::stoll(v, &used);
+      return used == v.size() && out >= 0;
+    } catch (...) {
+      return false;
+    }
+  };
+
+  const std::string size = req.has_param("pageSize") ? param("pageSize") : param("limit");
+  f.pageSize = size.empty() ? kDefaultPageSize : parseIntOr(size, 0);
+  if (f.pageSize < 1 || f.pageSize > kMaxPageSize) {
+    return "limit must be 1.." + std::to_string(kMaxPageSize);
+  }
+  if (req.has_param("page")) {
+    f.page = parseIntOr(param("page"), 0);
+    if (f.page < 1) return "page must be >= 1";
+  }
+
+  f.type = param("type");
+  if (!f.type.empty() && f.type != "INCOME" && f.type != "EXPENSE") {
+    return "type must be INCOME or EXPENSE";
+  }
+  f.startDate = param("startDate");
+  f.endDate = param("endDate");
+  if ((!f.startDate.empty() && !PgBinary::parseDate(f.startDate)) ||
+      (!f.endDate.empty() && !PgBinary::parseDate(f.endDate))) {
+    return "startDate/endDate must be YYYY-MM-DD";
+  }
+  f.category = req.has_param("category") ? param("category") : param("categoryId");
+  if (!cents("minAmountCents", f.minAmountCents) ||
+      !cents("maxAmountCents", f.maxAmountCents)) {
+    return "minAmountCents/maxAmountCents must be whole cents >= 0";
+  }
+  f.q = param("q");
+  if (!f.q.empty()) {
+    if (f.q.size() > kMaxQueryLength) {
+      return "q must be at most " + std::to_string(kMaxQueryLength) + " bytes";
+    }
+    if (TransactionSearch::tsQuery(f.q).empty()) return "q must contain a word";
+    f.sort = TransactionSearch::Sort::Relevance;
+  }
+  if (req.has_param("sort")) {
+    auto sort = TransactionSearch::parseSort(param("sort"));
+    if (!sort) {
+      return "sort must be date_desc, date_asc, amount_desc, amount_asc or relevance";
+    }
+    f.sort = *sort;
+  }
+  if (f.sort == TransactionSearch::Sort::Relevance && f.q.empty()) {
+    return "sort=relevance requires q";
+  }
+  return "";
+}
+
+// ---------------------- DB pool ----------------------
+
+// Checks out a pooled connection, or answers 503 so the client retries
+// instead of queueing behind a saturated pool.
+static DbPool::Lease acquireDb(DbPool& pool, httplib::Response& res,
+                               std::string_view origin) {
+  DbPool::Lease db = pool.acquire();
+  if (!db) {
+    res.set_header("Retry-After", "1");
+    jsonError(res, 503, "DB_UNAVAILABLE", "Database busy, try again", origin);
+  }
+  return db;
+}
+
+// Runs one standalone statement on AsyncDb's pipelined connections. Same
+// 503 as acquireDb when its queue is full; otherwise `r` is the caller's
+// (null if the connection failed). The handler's thread waits for the
+// result, so at most HTTP_THREADS of these are in flight.
+static bool execAsync(AsyncDb& adb, httplib::Response& res, std::string_view origin,
+                      const Sql::Statement& st, const char* const* params, PGresult*& r,
+                      int resultFormat = Sql::kTextResult) {
+  if (adb.exec(st, params, r, resultFormat)) return true;
+  res.set_header("Retry-After", "1");
+  jsonError(res, 503, "DB_UNAVAILABLE", "Database busy, try again", origin);
+  return false;
+}
+
+static json histogramJson(const Metrics::LatencyHistogram& h) {
+  json buckets = json::array();
+  for (int i = 0; i < Metrics::LatencyHistogram::kBuckets; i++) {
+    const uint64_t le = Metrics::LatencyHistogram::upperBoundMicros(i);
+    buckets.push_back({{"leMicros", le ? json(le) : json("+Inf")},
+                       {"count", h.bucket(i)}});
+  }
+  return {{"count", h.count()}, {"sum", h.sumMicros()}, {"buckets", buckets}};
+}
+
+static json poolStatsJson(const DbPool& pool) {
+  const DbPool::Stats s = pool.stats();
+
+  return {
+      {"size", s.size},
+      {"maxSize", s.maxSize},
+      {"idle", s.idle},
+      {"inUse", s.inUse},
+      {"waiters", s.waiters},
+      {"checkouts", s.checkouts},
+      {"timeouts", s.timeouts},
+      {"resets", s.resets},
+      {"connectFailures", s.connectFailures},
+      {"waitMicros", histogramJson(pool.waitHistogram())},
+  };
+}
+
+static json asyncDbStatsJson(const AsyncDb& adb) {
+  const AsyncDb::Stats s = adb.stats();
+
+  return {
+      {"connections", s.connections},
+      {"healthy", s.healthy},
+      {"inFlight", s.inFlight},
+      {"pending", s.pending},
+      {"submitted", s.submitted},
+      {"completed", s.completed},
+      {"failed", s.failed},
+      {"rejected", s.rejected},
+      {"resets", s.resets},
+  };
+}
+
+// ---------------------- Export ----------------------
+
+// What a streaming export keeps alive until httplib drops the content
+// provider. Permits are declared first so they outlive the connection.
+struct ExportStream {
+  ExportStream(ConcurrencyLimiter::Permit user, ConcurrencyLimiter::Permit slot,
+               DbPool::Lease db, TransactionExport::Format format, bool gzip)
+      : userPermit(std::move(user)),
+        slotPermit(std::move(slot)),
+        exp(std::move(db), format, gzip) {}
+
+  ConcurrencyLimiter::Permit userPermit;
+  ConcurrencyLimiter::Permit slotPermit;
+  TransactionExport exp;
+  std::string piece;
+};
+
+// ---------------------- Password hashing ----------------------
+
+// PBKDF2 (120k iterations) runs on its own bounded pool rather than on
+// httplib workers, so a login storm cannot starve every other endpoint.
+// Per-IP and per-email caps stop one client from filling the queue.
+struct HashWorkers {
+  HashWorkers(int threads, int maxQueue, int maxPerIp, int maxPerEmail)
+      : executor(threads, maxQueue), perIp(maxPerIp), perEmail(maxPerEmail) {}
+
+  BoundedExecutor executor;
+  ConcurrencyLimiter perIp;
+  ConcurrencyLimiter perEmail;
+  Metrics::LatencyHistogram latency;  // time spent hashing, per call
+};
+
+// The peer address, unless `trustProxy` (TRUST_PROXY=1: we sit behind a
+// proxy such as Render's). Then the rightmost X-Forwarded-For entry is
+// the one that proxy added; anything left of it is client-supplied. A
+// directly reachable server must not trust the header, or each request
+// could claim a new address and slip past the per-IP cap.
+static std::string clientIp(const httplib::Request& req, bool trustProxy) {
+  if (!trustProxy) return req.remote_addr;
+  const std::string xff = getHeaderOrEmpty(req, "X-Forwarded-For");
+  if (xff.empty()) return req.remote_addr;
+  const size_t comma = xff.rfind(',');
+  std::string ip = trimCopy(comma == std::string::npos ? xff : xff.substr(comma + 1));
+  return ip.empty() ? req.remote_addr : ip;
+}
+
+static void tooBusy(httplib::Response& res, int status, const std::string& code,
+                    std::string_view origin) {
+  res.set_header("Retry-After", "1");
+  jsonError(res, status, code, "Too many sign-in attempts, try again shortly",
+            origin);
+}
+
+// Runs `fn` on the hash pool and waits for its result. Returns nullopt,
+// having answered 503, when the pool's queue is full.
+template <class F>
+static std::optional<std::invoke_result_t<F>> runHash(
+    HashWorkers& hw, httplib::Response& res, std::string_view origin, F fn) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Hash);
+  auto fut = hw.executor.submit([&hw, fn = std::move(fn)] {
+    const auto t0 = std::chrono::steady_clock::now();
+    auto out = fn();
+    hw.latency.record(static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - t0)
+            .count()));
+    return out;
+  });
+  if (!fut) {
+    tooBusy(res, 503, "AUTH_BUSY", origin);
+    return std::nullopt;
+  }
+  return fut->get();
+}
+
+static json hashStatsJson(const HashWorkers& hw) {
+  return {
+      {"threads", hw.executor.threads()},
+      {"active", hw.executor.active()},
+      {"queueDepth", hw.executor.queueDepth()},
+      {"maxQueue", hw.executor.maxQueue()},
+      {"rejected", hw.executor.rejected()},
+      {"rejectedPerIp", hw.perIp.rejected()},
+      {"rejectedPerEmail", hw.perEmail.rejected()},
+      {"hashMicros", histogramJson(hw.latency)},
+  };
+}
+
+static json responseCacheStatsJson(const ResponseCache& c) {
+  return {
+      {"entries", c.entries()},
+      {"bytes", c.bytes()},
+      {"maxBytes", c.maxBytes()},
+      {"hits", c.hits()},
+      {"misses", c.misses()},
+      {"stale", c.stale()},
+      {"evictions", c.evictions()},
+  };
+}
+
+static json jwtCacheStatsJson(const JwtCache& c) {
+  return {
+      {"size", c.size()},
+      {"hits", c.hits()},
+      {"misses", c.misses()},
+      {"evictions", c.evictions()},
+  };
+}
+
+// ---------------------- Metrics ----------------------
+
+// Registers routes on `srv` wrapped in a Metrics::RequestTimer, labelled
+// "METHOD /pattern" with (\d+) shown as :id.
+class TimedRoutes {
+ public:
+  TimedRoutes(httplib::Server& srv, Metrics::RequestMetrics& metrics)
+      : m_srv(srv), m_metrics(metrics) {}
+
+  void Get(const std::string& pattern, httplib::Server::Handler h) {
+    m_srv.Get(pattern, wrap("GET", pattern, std::move(h)));
+  }
+  void Post(const std::string& pattern, httplib::Server::Handler h) {
+    m_srv.Post(pattern, wrap("POST", pattern, std::move(h)));
+  }
+  void Put(const std::string& pattern, httplib::Server::Handler h) {
+    m_srv.Put(pattern, wrap("PUT", pattern, std::move(h)));
+  }
+  void Patch(const std::string& pattern, httplib::Server::Handler h) {
+    m_srv.Patch(pattern, wrap("PATCH", pattern, std::move(h)));
+  }
+  void Delete(const std::string& pattern, httplib::Server::Handler h) {
+    m_srv.Delete(pattern, wrap("DELETE", pattern, std::move(h)));
+  }
+
+ private:
+  httplib::Server::Handler wrap(const char* method, std::string pattern,
+                                httplib::Server::Handler h) {
+    for (size_t at; (at = pattern.find("(\\d+)")) != std::string::npos;) {
+      pattern.replace(at, 5, ":id");
+    }
+    const int route = m_metrics.route(std::string(method) + ' ' + pattern);
+    return [&metrics = m_metrics, route, h = std::move(h)](const httplib::Request& req,
+                                                           httplib::Response& res) {
+      Metrics::RequestTimer timer(metrics, route);
+      h(req, res);
+      // Streamed bodies are counted at their declared length (0 if chunked).
+      timer.finish(res.status, req.body.size(),
+                   res.body.empty() ? res.content_length_ : res.body.size());
+    };
+  }
+
+  httplib::Server& m_srv;
+  Metrics::RequestMetrics& m_metrics;
+};
+
+// GET /metrics: per-route request metrics plus a few process-wide gauges.
+static void sendMetrics(httplib::Response& res, std::string body) {
+  res.status = 200;
+  res.set_content(std::move(body), "text/plain; version=0.0.4");
+}
+
 // ---------------------- Auth ----------------------
 
 static long requireAuth(const httplib::Request& req, httplib::Response& res,
-                        const std::string& jwtSecret,
-                        const std::string& origin) {
+                        const std::string& jwtSecret, JwtCache& jwtCache,
+                        std::string_view origin) {
+  Metrics::PhaseTimer timer(Metrics::Phase::Auth);
   auto it = req.headers.find("Authorization");
   if (it == req.headers.end()) {
     jsonError(res, 401, "UNAUTHORIZED", "Missing Authorization header", origin);
@@ -152,29 +607,559 @@ static long requireAuth(const httplib::Request& req, httplib::Response& res,
     return 0;
   }
 
-  auto userId = Jwt::verifyAndGetUserId(h.substr(prefix.size()), jwtSecret);
-  if (!userId) {
+  const std::string_view token = std::string_view(h).substr(prefix.size());
+  if (auto cached = jwtCache.lookup(token)) return *cached;
+
+  auto claims = Jwt::verify(token, jwtSecret);
+  if (!claims) {
     jsonError(res, 401, "UNAUTHORIZED", "Invalid or expired token", origin);
     return 0;
   }
-  return *userId;
+  jwtCache.remember(token, *claims);
+  return claims->userId;
+}
+
+// ---------------------- Core routes ----------------------
+
+// What the core routes need besides their CoreStore.
+struct CoreContext {
+  const std::string& jwtSecret;
+  const CorsPolicy& cors;
+  HashWorkers& hashWorkers;
+  JwtCache& jwtCache;
+  DataVersions& versions;
+  ResponseCache& responses;
+  bool trustProxy;  // see clientIp
+};
+
+// Answers a store call that did not succeed. Missing means something
+// different per route, so callers handle it before getting here.
+static void storeError(httplib::Response& res, CoreStore::Status status,
+                       const std::string& message, std::string_view origin) {
+  switch (status) {
+    case CoreStore::Status::Busy:
+      res.set_header("Retry-After", "1");
+      return jsonError(res, 503, "DB_UNAVAILABLE", "Database busy, try again", origin);
+    case CoreStore::Status::Unsupported:
+      return jsonError(res, 400, "VALIDATION_ERROR",
+                       "Filter not supported by this storage backend", origin);
+    default:
+      return jsonError(res, 500, "DB_ERROR", message, origin);
+  }
 }
 
+// Register, login, create/list/delete transactions and summary. Both
+// servers route these here; only the CoreStore differs.
+static void addCoreRoutes(TimedRoutes& routes, CoreStore& store, const CoreContext& ctx) {
+  using Status = CoreStore::Status;
+
+  routes.Post("/auth/register", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    json body;
+    if (!parseJsonBody(req, body)) {
+      return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
+    }
+
+    std::string name = body.value("name", "");
+    std::string email = body.value("email", "");
+    std::string password = body.value("password", "");
+
+    if (name.empty() || email.empty() || password.size() < 6) {
+      return jsonError(res, 400, "VALIDATION_ERROR",
+                       "name, email, password(>=6) required", origin);
+    }
+
+    auto ipPermit = ctx.hashWorkers.perIp.tryAcquire(clientIp(req, ctx.trustProxy));
+    if (!ipPermit) return tooBusy(res, 429, "TOO_MANY_REQUESTS", origin);
+
+    auto pwHash = runHash(ctx.hashWorkers, res, origin,
+                          [&] { return Password::hash(password); });
+    if (!pwHash) return;
+    ipPermit.reset();
+
+    long userId = 0;
+    const Status st = store.createUser(name, email, *pwHash, userId);
+    if (st == Status::Missing) {
+      return jsonError(res, 400, "REGISTER_FAILED",
+                       "Could not register (email may already exist)", origin);
+    }
+    if (st != Status::Ok) return storeError(res, st, "Could not register", origin);
+
+    std::string token = Jwt::signUser(userId, ctx.jwtSecret, 60 * 60 * 24);
+    jsonOk(res, {{"token", token}}, origin);
+  });
+
+  routes.Post("/auth/login", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    json body;
+    if (!parseJsonBody(req, body)) {
+      return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
+    }
+
+    std::string email = body.value("email", "");
+    std::string password = body.value("password", "");
+    if (email.empty() || password.empty()) {
+      return jsonError(res, 400, "VALIDATION_ERROR",
+                       "email and password required", origin);
+    }
+
+    // Admission control before any DB or PBKDF2 work.
+    auto ipPermit = ctx.hashWorkers.perIp.tryAcquire(clientIp(req, ctx.trustProxy));
+    if (!ipPermit) return tooBusy(res, 429, "TOO_MANY_REQUESTS", origin);
+    std::string emailKey = email;
+    std::transform(emailKey.begin(), emailKey.end(), emailKey.begin(),
+                   [](unsigned char c) { return std::tolower(c); });
+    auto emailPermit = ctx.hashWorkers.perEmail.tryAcquire(emailKey);
+    if (!emailPermit) return tooBusy(res, 429, "TOO_MANY_REQUESTS", origin);
+
+    CoreStore::User user;
+    const Status st = store.findUser(email, user);
+    if (st == Status::Missing) {
+      return jsonError(res, 401, "INVALID_CREDENTIALS",
+                       "Invalid email or password", origin);
+    }
+    if (st != Status::Ok) return storeError(res, st, "Could not sign in", origin);
+
+    auto valid = runHash(ctx.hashWorkers, res, origin, [&] {
+      return Password::verify(password, user.passwordHash);
+    });
+    if (!valid) return;
+    if (!*valid) {
+      return jsonError(res, 401, "INVALID_CREDENTIALS",
+                       "Invalid email or password", origin);
+    }
+
+    std::string token = Jwt::signUser(user.id, ctx.jwtSecret, 60 * 60 * 24);
+    jsonOk(res, {{"token", token}}, origin);
+  });
+
+  routes.Post("/transactions", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    long userId = requireAuth(req, res, ctx.jwtSecret, ctx.jwtCache, origin);
+    if (!userId) return;
+
+    json body;
+    if (!parseJsonBody(req, body)) {
+      return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
+    }
+
+    CoreStore::NewTransaction t;
+    t.type = body.value("type", "");
+    t.date = body.value("date", "");
+    t.category = body.value("category", "");
+    t.title = body.value("title", "");
+    t.note = body.value("note", "");
+    t.currency = body.value("currency", "CAD");
+    const auto amount = utils::Money::fromNumber(body.value("amount", 0.0), t.currency);
+    t.amountCents = amount ? amount->cents() : 0;
+
+    // Checked here rather than left to the database: SQLite would store
+    // any text as a date.
+    if ((t.type != "INCOME" && t.type != "EXPENSE") || t.amountCents <= 0 ||
+        !PgBinary::parseDate(t.date) || t.category.empty() || t.title.empty()) {
+      return jsonError(res, 400, "VALIDATION_ERROR",
+                       "type(INCOME/EXPENSE), amount>0, date, category, title required",
+                       origin);
+    }
+
+    long id = 0;
+    const Status st = store.insertTransaction(userId, t, id);
+    if (st != Status::Ok) {
+      return storeError(res, st, "Could not create transaction", origin);
+    }
+    ctx.versions.bump(userId);
+
+    jsonOk(res, {{"id", id}}, origin);
+  });
+
+  // List transactions: filters, sort and paging per TransactionSearch
+  routes.Get("/transactions", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    long userId = requireAuth(req, res, ctx.jwtSecret, ctx.jwtCache, origin);
+    if (!userId) return;
+
+    TransactionSearch::Filters filters;
+    const std::string bad = readListFilters(req, filters);
+    if (!bad.empty()) {
+      return jsonError(res, 400, "VALIDATION_ERROR", bad, origin);
+    }
+    if (req.has_param("cursor")) {
+      filters.after = Cursor::decode(req.get_param_value("cursor"));
+      if (!filters.after ||
+          filters.after->key != TransactionSearch::cursorKey(filters.sort)) {
+        return jsonError(res, 400, "BAD_CURSOR", "Invalid cursor", origin);
+      }
+    }
+    const int limit = filters.pageSize;
+
+    const Compression::Encoding enc = acceptedEncoding(req);
+    const std::string variant = encodedTarget(req, enc);
+    const std::string etag = ctx.versions.etag(userId, variant);
+    if (notModified(req, res, etag, origin)) return;
+
+    // First pages are what every device polls; deeper pages are not kept.
+    const bool cacheable = !filters.after && filters.page == 1;
+    if (cacheable) {
+      if (auto hit = ctx.responses.get(userId, variant, etag)) {
+        return sendCached(res, hit, etag, origin);
+      }
+    }
+
+    // ~160 bytes covers a typical row, so the buffer rarely regrows.
+    std::string body;
+    body.reserve(64 + static_cast<size_t>(limit) * 160);
+    JsonWriter w(body);
+    w.beginObject().key("items").beginArray();
+    const Cursor::Key key = TransactionSearch::cursorKey(filters.sort);
+    int n = 0;
+    Cursor::Position last{key, 0, 0};
+    // The store returns one extra row when there is a next page.
+    const Status st = store.listTransactions(userId, filters, [&](const TransactionRow& t) {
+      if (++n > limit) return;
+      t.writeJson(w);
+      last.value = key == Cursor::Key::Amount ? t.amountCents : t.date;
+      last.id = t.id;
+    });
+    if (st != Status::Ok) {
+      return storeError(res, st, "Could not fetch transactions", origin);
+    }
+    w.endArray().key("next_cursor");
+    if (n > limit) {
+      if (key == Cursor::Key::Offset) {
+        last.value = (filters.after ? filters.after->value
+                                    : static_cast<int64_t>(filters.page - 1) * limit) +
+                     limit;
+      }
+      w.value(Cursor::encode(last));
+    } else {
+      w.null();
+    }
+    w.endObject();
+
+    if (cacheable) {
+      // Compressed once here; hits send the stored bytes as they are.
+      const Compression::Encoding sent = Compression::apply(enc, body);
+      return sendCached(res, ctx.responses.put(userId, variant, etag, std::move(body), sent),
+                        etag, origin);
+    }
+    setEtag(res, etag);
+    sendJson(res, std::move(body), enc, origin);
+  });
+
+  routes.Delete(R"(/transactions/(\d+))",
+                [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    long userId = requireAuth(req, res, ctx.jwtSecret, ctx.jwtCache, origin);
+    if (!userId) return;
+
+    const long txId = std::atol(req.matches[1].str().c_str());
+    const Status st = store.deleteTransaction(userId, txId);
+    if (st == Status::Missing) {
+      return jsonError(res, 404, "NOT_FOUND", "Transaction not found", origin);
+    }
+    if (st != Status::Ok) {
+      return storeError(res, st, "Could not delete transaction", origin);
+    }
+
+    ctx.versions.bump(userId);
+    jsonOk(res, {{"ok", true}}, origin);
+  });
+
+  routes.Get("/summary", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, ctx.cors);
+
+    long userId = requireAuth(req, res, ctx.jwtSecret, ctx.jwtCache, origin);
+    if (!userId) return;
+
+    // Far below Compression::kMinBytes, so one identity body serves all.
+    const std::string etag = ctx.versions.etag(userId, req.target);
+    if (notModified(req, res, etag, origin)) return;
+    if (auto hit = ctx.responses.get(userId, req.target, etag)) {
+      return sendCached(res, hit, etag, origin);
+    }
+
+    int64_t income = 0;
+    int64_t expense = 0;
+    const Status st = store.summary(userId, income, expense);
+    if (st != Status::Ok) return storeError(res, st, "Could not fetch summary", origin);
+
+    Metrics::PhaseTimer serializeTimer(Metrics::Phase::Json);
+    const json body = {{"income", centsToAmount(income)},
+                       {"expense", centsToAmount(expense)},
+                       {"balance", centsToAmount(income - expense)},
+                       {"incomeCents", income},
+                       {"expenseCents", expense},
+                       {"balanceCents", income - expense}};
+    sendCached(res,
+               ctx.responses.put(userId, req.target, etag, body.dump(),
+                                 Compression::Encoding::Identity),
+               etag, origin);
+  });
+}
+
+// ---------------------- Postgres store ----------------------
+
+// SQLSTATE 23505 (unique_violation): the email is already registered.
+static bool isUniqueViolation(const PGresult* r) {
+  const char* state = r ? PQresultErrorField(r, PG_DIAG_SQLSTATE) : nullptr;
+  return state && std::strcmp(state, "23505") == 0;
+}
+
+// Standalone statements go to AsyncDb's pipelined connections; the
+// listing, whose SQL depends on the filters, checks one out of the pool.
+class PgCoreStore : public CoreStore {
+ public:
+  PgCoreStore(DbPool& pool, AsyncDb& asyncDb) : m_pool(pool), m_async(asyncDb) {}
+
+  Status createUser(const std::string& name, const std::string& email,
+                    const std::string& passwordHash, long& id) override {
+    const char* params[3] = {name.c_str(), email.c_str(), passwordHash.c_str()};
+    PGresult* r = nullptr;
+    if (!m_async.exec(Sql::kInsertUser, params, r)) return Status::Busy;
+    const Status st = rows(r) ? Status::Ok
+                      : isUniqueViolation(r) ? Status::Missing
+                                             : Status::Failed;
+    if (st == Status::Ok) id = std::atol(PQgetvalue(r, 0, 0));
+    clearRes(r);
+    return st;
+  }
+
+  Status findUser(const std::string& email, User& user) override {
+    const char* params[1] = {email.c_str()};
+    PGresult* r = nullptr;
+    if (!m_async.exec(Sql::kFindUserByEmail, params, r)) return Status::Busy;
+    const Status st = !rows(r) ? Status::Failed
+                      : PQntuples(r) != 1 ? Status::Missing
+                                          : Status::Ok;
+    if (st == Status::Ok) {
+      user.id = std::atol(PQgetvalue(r, 0, 0));
+      user.passwordHash = PQgetvalue(r, 0, 1);
+    }
+    clearRes(r);
+    return st;
+  }
+
+  Status insertTransaction(long userId, const NewTransaction& t, long& id) override {
+    const std::string userStr = std::to_string(userId);
+    const std::string amtStr = utils::Money(t.amountCents, t.currency).amountString();
+    const char* params[8] = {
+        userStr.c_str(), t.type.c_str(),     amtStr.c_str(),  t.currency.c_str(),
+        t.date.c_str(),  t.category.c_str(), t.title.c_str(), t.note.c_str(),
+    };
+    PGresult* r = nullptr;
+    if (!m_async.exec(Sql::kInsertTransaction, params, r)) return Status::Busy;
+    const Status st = rows(r) ? Status::Ok : Status::Failed;
+    if (st == Status::Ok) id = std::atol(PQgetvalue(r, 0, 0));
+    clearRes(r);
+    return st;
+  }
+
+  Status deleteTransaction(long userId, long id) override {
+    const std::string userStr = std::to_string(userId);
+    const std::string txStr = std::to_string(id);
+    const char* params[2] = {txStr.c_str(), userStr.c_str()};
+    PGresult* r = nullptr;
+    if (!m_async.exec(Sql::kDeleteTransaction, params, r)) return Status::Busy;
+    const Status st = !rows(r) ? Status::Failed
+                      : PQntuples(r) != 1 ? Status::Missing
+                                          : Status::Ok;
+    clearRes(r);
+    return st;
+  }
+
+  Status listTransactions(long userId, const TransactionSearch::Filters& f,
+                          const std::function<void(const TransactionRow&)>& each) override {
+    const TransactionSearch::Query q = TransactionSearch::build(userId, f);
+    std::vector<const char*> params;
+    for (const auto& p : q.params) params.push_back(p.c_str());
+
+    DbPool::Lease db = m_pool.acquire();
+    if (!db) return Status::Busy;
+    PGresult* r = Sql::exec(
+        *db, {q.name.c_str(), q.sql.c_str(), static_cast<int>(params.size())},
+        params.data(), Sql::kBinaryResult);
+    db = DbPool::Lease();
+    if (!rows(r)) {
+      clearRes(r);
+      return Status::Failed;
+    }
+
+    // `each` serializes straight out of the PGresult.
+    Metrics::PhaseTimer serializeTimer(Metrics::Phase::Json);
+    for (int i = 0; i < PQntuples(r); i++) each(TransactionRow::decode(r, i));
+    clearRes(r);
+    return Status::Ok;
+  }
+
+  Status summary(long userId, int64_t& incomeCents, int64_t& expenseCents) override {
+    const std::string userStr = std::to_string(userId);
+    const char* params[1] = {userStr.c_str()};
+    PGresult* r = nullptr;
+    if (!m_async.exec(Sql::kSummary, params, r, Sql::kBinaryResult)) return Status::Busy;
+    if (!rows(r)) {
+      clearRes(r);
+      return Status::Failed;
+    }
+    const bool found = PQntuples(r) == 1;
+    incomeCents = found ? PgBinary::int8(r, 0, 0) : 0;
+    expenseCents = found ? PgBinary::int8(r, 0, 1) : 0;
+    clearRes(r);
+    return Status::Ok;
+  }
+
+ private:
+  static bool rows(const PGresult* r) { return r && PQresultStatus(r) == PGRES_TUPLES_OK; }
+
+  DbPool& m_pool;
+  AsyncDb& m_async;
+};
+
+#ifdef FLOWFUND_SQLITE
+// ---------------------- Embedded (DB_BACKEND=sqlite) ----------------------
+
+// SqliteStore throws on database errors and lists newest first only.
+class SqliteCoreStore : public CoreStore {
+ public:
+  explicit SqliteCoreStore(SqliteStore& store) : m_store(store) {}
+
+  Status createUser(const std::string& name, const std::string& email,
+                    const std::string& passwordHash, long& id) override {
+    return guarded([&] {
+      const auto created = m_store.createUser(name, email, passwordHash);
+      if (!created) return Status::Missing;
+      id = *created;
+      return Status::Ok;
+    });
+  }
+
+  Status findUser(const std::string& email, User& user) override {
+    return guarded([&] {
+      auto found = m_store.findUser(email);
+      if (!found) return Status::Missing;
+      user.id = found->id;
+      user.passwordHash = std::move(found->passwordHash);
+      return Status::Ok;
+    });
+  }
+
+  Status insertTransaction(long userId, const NewTransaction& t, long& id) override {
+    return guarded([&] {
+      SqliteStore::NewTransaction row;
+      row.userId = userId;
+      row.type = t.type;
+      row.amountCents = t.amountCents;
+      row.currency = t.currency;
+      row.date = t.date;
+      row.category = t.category;
+      row.title = t.title;
+      row.note = t.note;
+      id = m_store.insertTransaction(row);
+      return Status::Ok;
+    });
+  }
+
+  Status deleteTransaction(long userId, long id) override {
+    return guarded([&] {
+      return m_store.deleteTransaction(userId, id) ? Status::Ok : Status::Missing;
+    });
+  }
+
+  Status listTransactions(long userId, const TransactionSearch::Filters& f,
+                          const std::function<void(const TransactionRow&)>& each) override {
+    if (!f.type.empty() || !f.startDate.empty() || !f.endDate.empty() ||
+        !f.category.empty() || f.minAmountCents >= 0 || f.maxAmountCents >= 0 ||
+        !f.q.empty() || f.sort != TransactionSearch::Sort::DateDesc || f.page != 1) {
+      return Status::Unsupported;
+    }
+    return guarded([&] {
+      m_store.listTransactions(userId, f.pageSize + 1, f.after, each);
+      return Status::Ok;
+    });
+  }
+
+  Status summary(long userId, int64_t& incomeCents, int64_t& expenseCents) override {
+    return guarded([&] {
+      const SqliteStore::Totals t = m_store.summary(userId);
+      incomeCents = t.incomeCents;
+      expenseCents = t.expenseCents;
+      return Status::Ok;
+    });
+  }
+
+ private:
+  template <class F>
+  static Status guarded(F fn) {
+    try {
+      return fn();
+    } catch (const std::exception& e) {
+      std::cerr << e.what() << "\n";
+      return Status::Failed;
+    }
+  }
+
+  SqliteStore& m_store;
+};
+
+// The core routes against a local SqliteStore. The Postgres-only
+// endpoints (bulk COPY, export, batch pipelines, rollups, PUT/PATCH) are
+// not served here, and listings take no filters beyond the cursor.
+static int serveSqlite(const std::string& host, int port, const CoreContext& core,
+                       Metrics::RequestMetrics& requestMetrics) {
+  const std::string path = Env::get("SQLITE_PATH", "flowfund.db");
+  SqliteStore store(path);
+  SqliteCoreStore coreStore(store);
+
+  httplib::Server srv;
+  TimedRoutes routes(srv, requestMetrics);
+  srv.set_pre_routing_handler(
+      [&](const httplib::Request& req, httplib::Response& res) {
+        return preflight(req, res, core.cors);
+      });
+
+  srv.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+    sendMetrics(res, requestMetrics.prometheus());
+  });
+
+  routes.Get("/", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, core.cors);
+    addCors(res, origin);
+    res.set_content("FlowFund API is running. Try /health", "text/plain");
+  });
+
+  routes.Get("/health", [&](const httplib::Request& req, httplib::Response& res) {
+    const std::string_view origin = resolveCorsOrigin(req, core.cors);
+    jsonOk(res, {{"ok", true}, {"backend", "sqlite"}}, origin);
+  });
+
+  addCoreRoutes(routes, coreStore, core);
+
+  std::cout << "FlowFund API (sqlite: " << path << ") listening on " << host << ":"
+            << port << "\n";
+  srv.listen(host.c_str(), port);
+  return 0;
+}
+#endif
+
 // ---------------------- Main ----------------------
 
-int main() {
+int main(int argc, char** argv) {
   try {
+    const std::string command = argc > 1 ? argv[1] : "";
+    if (!command.empty() && command != "--verify-balances" &&
+        command != "--rebuild-balances" && command != "--check-indexes") {
+      std::cerr << "usage: flowfund [--verify-balances | --rebuild-balances | "
+                   "--check-indexes]\n";
+      return 2;
+    }
+
     const int port = Env::getInt("PORT", 10000);
     const std::string host = "0.0.0.0";
 
-    std::string dbUrl = getDatabaseUrlOrEmpty();
-    if (dbUrl.empty()) {
-      std::cerr
-          << "DATABASE_URL is required (or POSTGRES_URL / RENDER_DATABASE_URL)\n";
-      return 1;
-    }
-    dbUrl = ensureSslMode(dbUrl);
-
     const std::string jwtSecret = Env::get("JWT_SECRET");
     if (jwtSecret.size() < 16) {
       std::cerr << "JWT_SECRET must be set (>=16 chars)\n";
@@ -185,10 +1170,61 @@ int main() {
     // CORS_ORIGIN=https://hetansh2744.github.io
     // or multiple:
     // CORS_ORIGIN=https://hetansh2744.github.io,https://your-static.onrender.com
+    // or every preview deploy:
+    // CORS_ORIGIN=https://hetansh2744.github.io,https://*.onrender.com
     const std::string corsOriginEnv =
         Env::get("CORS_ORIGIN", "https://hetansh2744.github.io");
+    const CorsPolicy cors(corsOriginEnv);
+
+    const int hwThreads =
+        std::max(1, static_cast<int>(std::thread::hardware_concurrency()) / 2);
+    HashWorkers hashWorkers(Env::getInt("HASH_THREADS", hwThreads),
+                            Env::getInt("HASH_QUEUE_MAX", 64),
+                            Env::getInt("LOGIN_MAX_PER_IP", 4),
+                            Env::getInt("LOGIN_MAX_PER_EMAIL", 2));
+
+    JwtCache jwtCache(static_cast<size_t>(Env::getInt("JWT_CACHE_SIZE", 10000)));
+
+    Metrics::RequestMetrics requestMetrics;
+
+    DataVersions versions;
+    ResponseCache responses(
+        static_cast<size_t>(std::max(0, Env::getInt("RESPONSE_CACHE_MB", 64))) << 20,
+        static_cast<size_t>(std::max(0, Env::getInt("RESPONSE_CACHE_MAX_ENTRY_KB", 256)))
+            << 10);
+    // Set this on Render (or behind any proxy that appends
+    // X-Forwarded-For): TRUST_PROXY=1
+    const bool trustProxy = Env::getInt("TRUST_PROXY", 0) != 0;
+
+    const CoreContext core{jwtSecret, cors,      hashWorkers, jwtCache,
+                           versions,  responses, trustProxy};
+
+    // DB_BACKEND=sqlite serves the core API from a local file instead.
+    const std::string backend = Env::get("DB_BACKEND", "postgres");
+    if (backend == "sqlite") {
+#ifdef FLOWFUND_SQLITE
+      if (!command.empty()) {
+        std::cerr << command << " needs DB_BACKEND=postgres\n";
+        return 2;
+      }
+      return serveSqlite(host, port, core, requestMetrics);
+#else
+      std::cerr << "DB_BACKEND=sqlite needs a build with -DFLOWFUND_SQLITE=ON\n";
+      return 1;
+#endif
+    }
+    if (backend != "postgres") {
+      std::cerr << "DB_BACKEND must be postgres or sqlite\n";
+      return 1;
+    }
 
-    Db db(dbUrl);
+    std::string dbUrl = getDatabaseUrlOrEmpty();
+    if (dbUrl.empty()) {
+      std::cerr
+          << "DATABASE_URL is required (or POSTGRES_URL / RENDER_DATABASE_URL)\n";
+      return 1;
+    }
+    dbUrl = ensureSslMode(dbUrl);
 
     // Run migrations (local then /app)
     std::string mig = readFile("migrations.sql");
@@ -199,211 +1235,342 @@ int main() {
              "/app/migrations.sql)\n";
       return 1;
     }
-    db.execOrThrow(mig);
+    {
+      // Migrate before the pool opens, so every pooled connection can
+      // prepare its statements against the final schema.
+      Db db(dbUrl);
+      db.execOrThrow(mig);
+
+      // Maintenance commands run against the migrated schema and exit.
+      if (command == "--verify-balances") {
+        const Balances::Drift d = Balances::verify(db);
+        std::cout << "balance drift: " << d.users << " user(s), " << d.buckets
+                  << " monthly bucket(s)\n";
+        return (d.users || d.buckets) ? 3 : 0;
+      }
+      if (command == "--rebuild-balances") {
+        Balances::rebuild(db);
+        std::cout << "balances rebuilt\n";
+        return 0;
+      }
+      if (command == "--check-indexes") {
+        const auto failures = TransactionSearch::checkIndexes(db);
+        for (const auto& f : failures) std::cout << "not index-driven: " << f << "\n";
+        std::cout << (failures.empty() ? "all filter combinations use an index\n"
+                                       : "index check failed\n");
+        return failures.empty() ? 0 : 4;
+      }
+    }
 
-    httplib::Server srv;
+    DbPoolOptions poolOpts;
+    poolOpts.minSize = Env::getInt("DB_POOL_MIN", poolOpts.minSize);
+    poolOpts.maxSize = Env::getInt("DB_POOL_MAX", poolOpts.maxSize);
+    poolOpts.checkoutTimeoutMs =
+        Env::getInt("DB_POOL_TIMEOUT_MS", poolOpts.checkoutTimeoutMs);
+    DbPool pool(dbUrl, poolOpts, Sql::prepareAll);
 
-    // Preflight (CORS)
-    srv.Options(R"(.*)", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
-      addCors(res, origin);
-      res.status = 204;
-    });
+    // Single-statement handlers share these pipelined connections instead
+    // of checking one out of the pool each.
+    AsyncDbOptions asyncOpts;
+    asyncOpts.connections = Env::getInt("ASYNC_DB_CONNECTIONS", asyncOpts.connections);
+    asyncOpts.pipelineDepth = Env::getInt("ASYNC_DB_PIPELINE_DEPTH", asyncOpts.pipelineDepth);
+    asyncOpts.maxPending = Env::getInt("ASYNC_DB_MAX_PENDING", asyncOpts.maxPending);
+    AsyncDb asyncDb(dbUrl, asyncOpts);
+
+    const size_t bulkMaxRows =
+        static_cast<size_t>(std::max(1, Env::getInt("BULK_MAX_ROWS", 100000)));
+    ConcurrencyLimiter bulkPerUser(Env::getInt("BULK_MAX_PER_USER", 1));
+
+    const size_t batchMaxOps =
+        static_cast<size_t>(std::max(1, Env::getInt("BATCH_MAX_OPS", 500)));
+
+    ConcurrencyLimiter exportPerUser(Env::getInt("EXPORT_MAX_PER_USER", 1));
+    ConcurrencyLimiter exportSlots(Env::getInt("EXPORT_MAX_CONCURRENT", 2));
+
+
+    // Handlers block on the database, so this is also the ceiling on
+    // queries in flight: AsyncDb multiplexes them over a few connections
+    // but cannot run more than there are threads waiting. Default matches
+    // httplib's (CPPHTTPLIB_THREAD_POOL_COUNT).
+    const int httpThreads = std::max(
+        1, Env::getInt("HTTP_THREADS",
+                       std::max(8, static_cast<int>(std::thread::hardware_concurrency()) - 1)));
+
+    httplib::Server srv;
+    srv.new_task_queue = [httpThreads] {
+      return new httplib::ThreadPool(static_cast<size_t>(httpThreads));
+    };
+    TimedRoutes routes(srv, requestMetrics);
+
+    // Preflight (CORS), answered before any route matching
+    srv.set_pre_routing_handler(
+        [&](const httplib::Request& req, httplib::Response& res) {
+          return preflight(req, res, cors);
+        });
 
     // Root
-    srv.Get("/", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    routes.Get("/", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
       addCors(res, origin);
       res.set_content("FlowFund API is running. Try /health", "text/plain");
     });
 
     // Health
-    srv.Get("/health", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    routes.Get("/health", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
       jsonOk(res, {{"ok", true}}, origin);
     });
 
-    // Register
-    srv.Post("/auth/register", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    // Prometheus scrape target; not itself timed.
+    srv.Get("/metrics", [&](const httplib::Request&, httplib::Response& res) {
+      std::string body = requestMetrics.prometheus();
+      const DbPool::Stats ps = pool.stats();
+      Metrics::writeGauge(body, "flowfund_db_pool_in_use", "Pooled connections checked out.",
+                          ps.inUse);
+      Metrics::writeGauge(body, "flowfund_db_pool_waiters",
+                          "Requests waiting for a pooled connection.", ps.waiters);
+      Metrics::writeCounter(body, "flowfund_db_pool_timeouts_total",
+                            "Pool checkouts that timed out.", ps.timeouts);
+      const AsyncDb::Stats as = asyncDb.stats();
+      Metrics::writeGauge(body, "flowfund_async_db_in_flight",
+                          "Statements sent on pipelined connections, awaiting results.",
+                          as.inFlight);
+      Metrics::writeCounter(body, "flowfund_async_db_rejected_total",
+                            "Statements refused because the queue was full.", as.rejected);
+      Metrics::writeGauge(body, "flowfund_hash_queue_depth", "PBKDF2 jobs waiting.",
+                          static_cast<double>(hashWorkers.executor.queueDepth()));
+      Metrics::writeCounter(body, "flowfund_jwt_cache_hits_total", "JWT cache hits.",
+                            jwtCache.hits());
+      Metrics::writeCounter(body, "flowfund_jwt_cache_misses_total", "JWT cache misses.",
+                            jwtCache.misses());
+      Metrics::writeCounter(body, "flowfund_response_cache_hits_total",
+                            "Response cache hits.", responses.hits());
+      Metrics::writeCounter(body, "flowfund_response_cache_misses_total",
+                            "Response cache misses.", responses.misses());
+      Metrics::writeGauge(body, "flowfund_response_cache_bytes", "Response cache size.",
+                          static_cast<double>(responses.bytes()));
+      sendMetrics(res, std::move(body));
+    });
 
-      json body;
-      if (!parseJsonBody(req, body)) {
-        return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
-      }
+    // DB pool stats, for sizing DB_POOL_MAX against the httplib thread pool
+    routes.Get("/health/db", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
+      json body = poolStatsJson(pool);
+      body["async"] = asyncDbStatsJson(asyncDb);
+      body["httpThreads"] = httpThreads;
+      jsonOk(res, body, origin);
+    });
 
-      std::string name = body.value("name", "");
-      std::string email = body.value("email", "");
-      std::string password = body.value("password", "");
+    // Password hashing pool and JWT cache stats
+    routes.Get("/health/auth", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
+      jsonOk(res,
+             {{"hashing", hashStatsJson(hashWorkers)},
+              {"jwtCache", jwtCacheStatsJson(jwtCache)}},
+             origin);
+    });
 
-      if (name.empty() || email.empty() || password.size() < 6) {
-        return jsonError(res, 400, "VALIDATION_ERROR",
-                         "name, email, password(>=6) required", origin);
-      }
+    // Response cache stats (hit rate, memory)
+    routes.Get("/health/cache", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
+      jsonOk(res, responseCacheStatsJson(responses), origin);
+    });
 
-      std::string pwHash = Password::hash(password);
+    // Register, login, create/list/delete and summary, shared with the
+    // SQLite server.
+    PgCoreStore coreStore(pool, asyncDb);
+    addCoreRoutes(routes, coreStore, core);
 
-      const char* params[3] = {name.c_str(), email.c_str(), pwHash.c_str()};
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "INSERT INTO users(name,email,password_hash) "
-          "VALUES($1,$2,$3) RETURNING id",
-          3, nullptr, params, nullptr, nullptr, 0);
+    // Bulk import: a JSON array or CSV upload, loaded with one COPY.
+    routes.Post("/transactions/bulk", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
-        clearRes(r);
-        return jsonError(res, 400, "REGISTER_FAILED",
-                         "Could not register (email may already exist)", origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
+      if (!userId) return;
+
+      // One import at a time per user; each holds a pooled connection.
+      auto permit = bulkPerUser.tryAcquire(std::to_string(userId));
+      if (!permit) {
+        res.set_header("Retry-After", "5");
+        return jsonError(res, 429, "IMPORT_IN_PROGRESS",
+                         "Another import is still running", origin);
       }
 
-      long userId = std::atol(PQgetvalue(r, 0, 0));
-      clearRes(r);
+      const bool csv = req.get_header_value("Content-Type").rfind("text/csv", 0) == 0;
+      BulkImport::Parsed parsed = csv ? BulkImport::parseCsv(req.body, bulkMaxRows)
+                                      : BulkImport::parseJson(req.body, bulkMaxRows);
+      if (!parsed.fatal.empty()) {
+        return jsonError(res, 400, csv ? "BAD_CSV" : "BAD_JSON", parsed.fatal, origin);
+      }
+      if (parsed.total == 0) {
+        return jsonError(res, 400, "VALIDATION_ERROR", "No rows to import", origin);
+      }
+      if (parsed.errorCount) {
+        return bulkRowErrors(res, parsed.errorCount, parsed.errors, origin);
+      }
 
-      std::string token = Jwt::signUser(userId, jwtSecret, 60 * 60 * 24);
-      jsonOk(res, {{"token", token}}, origin);
+      auto db = acquireDb(pool, res, origin);
+      if (!db) return;
+      const BulkImport::Result loaded = BulkImport::load(*db, userId, parsed.rows);
+      db = DbPool::Lease();
+
+      if (!loaded.error.empty()) {
+        if (loaded.failedRow) {
+          return bulkRowErrors(res, 1, {{loaded.failedRow, loaded.error}}, origin);
+        }
+        std::cerr << "bulk import failed: " << loaded.error << "\n";
+        return jsonError(res, 500, "DB_ERROR", "Could not import transactions", origin);
+      }
+      versions.bump(userId);
+
+      std::string body;
+      JsonWriter w(body);
+      w.beginObject()
+          .key("inserted").value(static_cast<int64_t>(parsed.rows.size()))
+          .key("ids").beginArray();
+      for (const auto& range : loaded.ids) {
+        w.beginArray().value(range.first).value(range.second).endArray();
+      }
+      w.endArray().endObject();
+
+      sendJson(res, std::move(body), acceptedEncoding(req), origin);
     });
 
-    // Login
-    srv.Post("/auth/login", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    // Full history export, streamed: ?format=csv|ndjson&startDate=&endDate=
+    routes.Get("/transactions/export", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      json body;
-      if (!parseJsonBody(req, body)) {
-        return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
+      if (!userId) return;
+
+      const std::string format =
+          req.has_param("format") ? req.get_param_value("format") : "csv";
+      if (format != "csv" && format != "ndjson") {
+        return jsonError(res, 400, "VALIDATION_ERROR", "format must be csv or ndjson",
+                         origin);
       }
 
-      std::string email = body.value("email", "");
-      std::string password = body.value("password", "");
-      if (email.empty() || password.empty()) {
+      // Inclusive bounds, as in TransactionFilters; either may be omitted.
+      const std::string startDate = req.get_param_value("startDate");
+      const std::string endDate = req.get_param_value("endDate");
+      if ((!startDate.empty() && !PgBinary::parseDate(startDate)) ||
+          (!endDate.empty() && !PgBinary::parseDate(endDate))) {
         return jsonError(res, 400, "VALIDATION_ERROR",
-                         "email and password required", origin);
+                         "startDate/endDate must be YYYY-MM-DD", origin);
       }
 
-      const char* params[1] = {email.c_str()};
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "SELECT id, password_hash FROM users WHERE email=$1",
-          1, nullptr, params, nullptr, nullptr, 0);
-
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK || PQntuples(r) != 1) {
-        clearRes(r);
-        return jsonError(res, 401, "INVALID_CREDENTIALS",
-                         "Invalid email or password", origin);
+      // Exports pin a pooled connection for as long as the client reads.
+      auto userPermit = exportPerUser.tryAcquire(std::to_string(userId));
+      if (!userPermit) {
+        res.set_header("Retry-After", "5");
+        return jsonError(res, 429, "EXPORT_IN_PROGRESS",
+                         "Another export is still running", origin);
+      }
+      auto slotPermit = exportSlots.tryAcquire("export");
+      if (!slotPermit) {
+        res.set_header("Retry-After", "5");
+        return jsonError(res, 503, "EXPORT_BUSY", "Too many exports, try again shortly",
+                         origin);
       }
 
-      long userId = std::atol(PQgetvalue(r, 0, 0));
-      std::string storedHash = PQgetvalue(r, 0, 1);
-      clearRes(r);
-
-      if (!Password::verify(password, storedHash)) {
-        return jsonError(res, 401, "INVALID_CREDENTIALS",
-                         "Invalid email or password", origin);
+      auto db = acquireDb(pool, res, origin);
+      if (!db) return;
+
+      const bool csv = format == "csv";
+      const bool gzip =
+          Compression::accepts(getHeaderOrEmpty(req, "Accept-Encoding"), "gzip");
+      auto stream = std::make_shared<ExportStream>(
+          std::move(*userPermit), std::move(*slotPermit), std::move(db),
+          csv ? TransactionExport::Format::Csv : TransactionExport::Format::Ndjson,
+          gzip);
+      if (!stream->exp.start(userId, startDate.empty() ? nullptr : startDate.c_str(),
+                             endDate.empty() ? nullptr : endDate.c_str())) {
+        std::cerr << "export failed: " << stream->exp.error() << "\n";
+        return jsonError(res, 500, "DB_ERROR", "Could not export transactions", origin);
       }
 
-      std::string token = Jwt::signUser(userId, jwtSecret, 60 * 60 * 24);
-      jsonOk(res, {{"token", token}}, origin);
+      addCors(res, origin);
+      res.set_header("Content-Disposition", csv
+                         ? "attachment; filename=\"transactions.csv\""
+                         : "attachment; filename=\"transactions.ndjson\"");
+      res.set_header("Vary", "Accept-Encoding");
+      if (gzip) res.set_header("Content-Encoding", "gzip");
+      res.set_chunked_content_provider(
+          csv ? "text/csv; charset=utf-8" : "application/x-ndjson",
+          [stream](size_t, httplib::DataSink& sink) {
+            stream->piece.clear();
+            const bool more = stream->exp.next(stream->piece);
+            if (!stream->piece.empty() &&
+                !sink.write(stream->piece.data(), stream->piece.size())) {
+              return false;  // client gone; ~TransactionExport cancels
+            }
+            if (stream->exp.failed()) {
+              // Headers are out; cutting the stream short is all we can do.
+              std::cerr << "export failed: " << stream->exp.error() << "\n";
+              return false;
+            }
+            if (!more) sink.done();
+            return true;
+          });
     });
 
-    // Create transaction
-    srv.Post("/transactions", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    // Batched create/update/delete, pipelined in one transaction
+    routes.Post("/transactions/batch", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      long userId = requireAuth(req, res, jwtSecret, origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
       if (!userId) return;
 
       json body;
       if (!parseJsonBody(req, body)) {
         return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
       }
-
-      std::string type = body.value("type", "");
-      double amount = body.value("amount", 0.0);
-      std::string date = body.value("date", "");
-      std::string category = body.value("category", "");
-      std::string title = body.value("title", "");
-      std::string note = body.value("note", "");
-      std::string currency = body.value("currency", "CAD");
-
-      if ((type != "INCOME" && type != "EXPENSE") || amount <= 0 || date.empty() ||
-          category.empty() || title.empty()) {
+      auto list = body.is_object() ? body.find("ops") : body.end();
+      if (!body.is_object() || list == body.end() || !list->is_array() ||
+          list->empty() || list->size() > batchMaxOps) {
         return jsonError(res, 400, "VALIDATION_ERROR",
-                         "type(INCOME/EXPENSE), amount>0, date, category, title required",
+                         "ops must be an array of 1.." + std::to_string(batchMaxOps) +
+                             " operations",
                          origin);
       }
 
-      std::string userStr = std::to_string(userId);
-      std::string amtStr = std::to_string(amount);
-
-      const char* params[8] = {
-          userStr.c_str(), type.c_str(),      amtStr.c_str(),
-          currency.c_str(), date.c_str(),     category.c_str(),
-          title.c_str(),     note.c_str(),
-      };
-
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "INSERT INTO transactions(user_id,type,amount,currency,tx_date,category,title,note) "
-          "VALUES($1,$2,$3,$4,$5,$6,$7,$8) RETURNING id",
-          8, nullptr, params, nullptr, nullptr, 0);
-
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
-        clearRes(r);
-        return jsonError(res, 500, "DB_ERROR", "Could not create transaction", origin);
+      std::vector<TransactionBatch::Op> ops;
+      if (auto bad = TransactionBatch::parse(*list, ops)) {
+        return batchError(res, 400, "VALIDATION_ERROR", *bad, origin);
       }
 
-      long id = std::atol(PQgetvalue(r, 0, 0));
-      clearRes(r);
-
-      jsonOk(res, {{"id", id}}, origin);
-    });
-
-    // List transactions
-    srv.Get("/transactions", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+      auto db = acquireDb(pool, res, origin);
+      if (!db) return;
+      const TransactionBatch::Outcome out = TransactionBatch::run(*db, userId, ops);
+      db = DbPool::Lease();
 
-      long userId = requireAuth(req, res, jwtSecret, origin);
-      if (!userId) return;
-
-      std::string userStr = std::to_string(userId);
-      const char* params[1] = {userStr.c_str()};
-
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "SELECT id,type,amount,currency,tx_date,category,title,COALESCE(note,'') "
-          "FROM transactions WHERE user_id=$1 "
-          "ORDER BY tx_date DESC, id DESC LIMIT 200",
-          1, nullptr, params, nullptr, nullptr, 0);
-
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
-        clearRes(r);
-        return jsonError(res, 500, "DB_ERROR", "Could not fetch transactions", origin);
-      }
-
-      json items = json::array();
-      int n = PQntuples(r);
-      for (int i = 0; i < n; i++) {
-        items.push_back({
-            {"id", std::atol(PQgetvalue(r, i, 0))},
-            {"type", PQgetvalue(r, i, 1)},
-            {"amount", std::stod(PQgetvalue(r, i, 2))},
-            {"currency", PQgetvalue(r, i, 3)},
-            {"date", PQgetvalue(r, i, 4)},
-            {"category", PQgetvalue(r, i, 5)},
-            {"title", PQgetvalue(r, i, 6)},
-            {"note", PQgetvalue(r, i, 7)},
-        });
+      using Status = TransactionBatch::Outcome::Status;
+      if (out.status == Status::NotFound) {
+        return batchError(res, 404, "NOT_FOUND", out.failure, origin);
       }
-      clearRes(r);
+      if (out.status == Status::DbError) {
+        std::cerr << "batch failed at op " << out.failure.index << ": "
+                  << out.failure.message << "\n";
+        return batchError(res, 500, "DB_ERROR",
+                          {out.failure.index, "Could not apply batch"}, origin);
+      }
+      versions.bump(userId);
 
-      jsonOk(res, {{"items", items}}, origin);
+      std::string resBody;
+      JsonWriter w(resBody);
+      w.beginObject().key("ids").beginArray();
+      for (const std::string& id : out.ids) w.raw(id);
+      w.endArray().endObject();
+
+      sendJson(res, std::move(resBody), acceptedEncoding(req), origin);
     });
 
     // EDIT transaction (PUT) - full update
-    srv.Put(R"(/transactions/(\d+))",
+    routes.Put(R"(/transactions/(\d+))",
             [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      long userId = requireAuth(req, res, jwtSecret, origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
       if (!userId) return;
 
       const long txId = std::atol(req.matches[1].str().c_str());
@@ -414,15 +1581,15 @@ int main() {
       }
 
       std::string type = body.value("type", "");
-      double amount = body.value("amount", 0.0);
       std::string date = body.value("date", "");
       std::string category = body.value("category", "");
       std::string title = body.value("title", "");
       std::string note = body.value("note", "");
       std::string currency = body.value("currency", "CAD");
+      const auto amount = utils::Money::fromNumber(body.value("amount", 0.0), currency);
 
-      if ((type != "INCOME" && type != "EXPENSE") || amount <= 0 || date.empty() ||
-          category.empty() || title.empty()) {
+      if ((type != "INCOME" && type != "EXPENSE") || !amount || amount->cents() <= 0 ||
+          !PgBinary::parseDate(date) || category.empty() || title.empty()) {
         return jsonError(res, 400, "VALIDATION_ERROR",
                          "type(INCOME/EXPENSE), amount>0, date, category, title required",
                          origin);
@@ -430,7 +1597,7 @@ int main() {
 
       std::string userStr = std::to_string(userId);
       std::string txStr = std::to_string(txId);
-      std::string amtStr = std::to_string(amount);
+      std::string amtStr = amount->amountString();
 
       const char* params[9] = {
           type.c_str(), amtStr.c_str(), currency.c_str(),
@@ -438,12 +1605,8 @@ int main() {
           txStr.c_str(), userStr.c_str()
       };
 
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "UPDATE transactions SET type=$1, amount=$2, currency=$3, tx_date=$4, "
-          "category=$5, title=$6, note=$7 "
-          "WHERE id=$8 AND user_id=$9 RETURNING id",
-          9, nullptr, params, nullptr, nullptr, 0);
+      PGresult* r = nullptr;
+      if (!execAsync(asyncDb, res, origin, Sql::kUpdateTransaction, params, r)) return;
 
       if (!r || PQresultStatus(r) != PGRES_TUPLES_OK || PQntuples(r) != 1) {
         clearRes(r);
@@ -451,15 +1614,16 @@ int main() {
       }
 
       clearRes(r);
+      versions.bump(userId);
       jsonOk(res, {{"ok", true}}, origin);
     });
 
     // EDIT transaction (PATCH) - partial update
-    srv.Patch(R"(/transactions/(\d+))",
+    routes.Patch(R"(/transactions/(\d+))",
               [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      long userId = requireAuth(req, res, jwtSecret, origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
       if (!userId) return;
 
       const long txId = std::atol(req.matches[1].str().c_str());
@@ -469,89 +1633,22 @@ int main() {
         return jsonError(res, 400, "BAD_JSON", "Invalid JSON", origin);
       }
 
-      // Fetch existing first
-      std::string userStr = std::to_string(userId);
-      std::string txStr = std::to_string(txId);
-      const char* paramsSel[2] = {txStr.c_str(), userStr.c_str()};
-
-      PGresult* sel = PQexecParams(
-          db.conn(),
-          "SELECT type,amount,currency,tx_date,category,title,COALESCE(note,'') "
-          "FROM transactions WHERE id=$1 AND user_id=$2",
-          2, nullptr, paramsSel, nullptr, nullptr, 0);
-
-      if (!sel || PQresultStatus(sel) != PGRES_TUPLES_OK || PQntuples(sel) != 1) {
-        clearRes(sel);
-        return jsonError(res, 404, "NOT_FOUND", "Transaction not found", origin);
-      }
-
-      std::string type = PQgetvalue(sel, 0, 0);
-      double amount = std::stod(PQgetvalue(sel, 0, 1));
-      std::string currency = PQgetvalue(sel, 0, 2);
-      std::string date = PQgetvalue(sel, 0, 3);
-      std::string category = PQgetvalue(sel, 0, 4);
-      std::string title = PQgetvalue(sel, 0, 5);
-      std::string note = PQgetvalue(sel, 0, 6);
-      clearRes(sel);
-
-      // Apply patches
-      if (body.contains("type")) type = body.value("type", type);
-      if (body.contains("amount")) amount = body.value("amount", amount);
-      if (body.contains("currency")) currency = body.value("currency", currency);
-      if (body.contains("date")) date = body.value("date", date);
-      if (body.contains("category")) category = body.value("category", category);
-      if (body.contains("title")) title = body.value("title", title);
-      if (body.contains("note")) note = body.value("note", note);
-
-      if ((type != "INCOME" && type != "EXPENSE") || amount <= 0 || date.empty() ||
-          category.empty() || title.empty()) {
-        return jsonError(res, 400, "VALIDATION_ERROR",
-                         "type(INCOME/EXPENSE), amount>0, date, category, title required",
-                         origin);
+      // Absent fields stay as they are; one UPDATE, one round trip.
+      TransactionBatch::Op patch;
+      patch.id = std::to_string(txId);
+      const std::string err = TransactionBatch::readFields(body, true, patch);
+      if (!err.empty()) {
+        return jsonError(res, 400, "VALIDATION_ERROR", err, origin);
       }
 
-      std::string amtStr = std::to_string(amount);
-
-      const char* paramsUpd[9] = {
-          type.c_str(), amtStr.c_str(), currency.c_str(),
-          date.c_str(), category.c_str(), title.c_str(), note.c_str(),
-          txStr.c_str(), userStr.c_str()
-      };
-
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "UPDATE transactions SET type=$1, amount=$2, currency=$3, tx_date=$4, "
-          "category=$5, title=$6, note=$7 "
-          "WHERE id=$8 AND user_id=$9 RETURNING id",
-          9, nullptr, paramsUpd, nullptr, nullptr, 0);
-
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK || PQntuples(r) != 1) {
-        clearRes(r);
-        return jsonError(res, 404, "NOT_FOUND", "Transaction not found", origin);
-      }
-
-      clearRes(r);
-      jsonOk(res, {{"ok", true}}, origin);
-    });
-
-    // DELETE transaction
-    srv.Delete(R"(/transactions/(\d+))",
-               [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
-
-      long userId = requireAuth(req, res, jwtSecret, origin);
-      if (!userId) return;
-
-      const long txId = std::atol(req.matches[1].str().c_str());
-
       std::string userStr = std::to_string(userId);
-      std::string txStr = std::to_string(txId);
-      const char* params[2] = {txStr.c_str(), userStr.c_str()};
+      const std::vector<const char*> params =
+          TransactionBatch::patchParams(patch, userStr);
 
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "DELETE FROM transactions WHERE id=$1 AND user_id=$2 RETURNING id",
-          2, nullptr, params, nullptr, nullptr, 0);
+      PGresult* r = nullptr;
+      if (!execAsync(asyncDb, res, origin, Sql::kPatchTransaction, params.data(), r)) {
+        return;
+      }
 
       if (!r || PQresultStatus(r) != PGRES_TUPLES_OK || PQntuples(r) != 1) {
         clearRes(r);
@@ -559,41 +1656,89 @@ int main() {
       }
 
       clearRes(r);
+      versions.bump(userId);
       jsonOk(res, {{"ok", true}}, origin);
     });
 
-    // Summary
-    srv.Get("/summary", [&](const httplib::Request& req, httplib::Response& res) {
-      const std::string origin = resolveCorsOrigin(req, corsOriginEnv);
+    // Income/expense/net per month, category or week of one year, in a
+    // single grouped query rather than one query per bucket and type.
+    routes.Get("/summary/rollup", [&](const httplib::Request& req, httplib::Response& res) {
+      const std::string_view origin = resolveCorsOrigin(req, cors);
 
-      long userId = requireAuth(req, res, jwtSecret, origin);
+      long userId = requireAuth(req, res, jwtSecret, jwtCache, origin);
       if (!userId) return;
 
-      std::string userStr = std::to_string(userId);
-      const char* params[1] = {userStr.c_str()};
-
-      PGresult* r = PQexecParams(
-          db.conn(),
-          "SELECT "
-          "COALESCE(SUM(CASE WHEN type='INCOME' THEN amount END),0) AS income, "
-          "COALESCE(SUM(CASE WHEN type='EXPENSE' THEN amount END),0) AS expense "
-          "FROM transactions WHERE user_id=$1",
-          1, nullptr, params, nullptr, nullptr, 0);
-
-      if (!r || PQresultStatus(r) != PGRES_TUPLES_OK) {
-        clearRes(r);
-        return jsonError(res, 500, "DB_ERROR", "Could not fetch summary", origin);
+      int year = 0;
+      if (req.has_param("year")) {
+        year = parseIntOr(req.get_param_value("year"), 0);
+      } else {
+        const std::time_t now = std::time(nullptr);
+        std::tm utc{};
+        gmtime_r(&now, &utc);
+        year = utc.tm_year + 1900;
+      }
+      if (year < 1 || year > 9998) {
+        return jsonError(res, 400, "VALIDATION_ERROR", "year must be 1..9998", origin);
+      }
+      const std::string groupName =
+          req.has_param("group") ? req.get_param_value("group") : "month";
+      const auto group = Rollup::parseGroup(groupName);
+      if (!group) {
+        return jsonError(res, 400, "VALIDATION_ERROR",
+                         "group must be month, category or week", origin);
       }
 
-      double income = std::stod(PQgetvalue(r, 0, 0));
-      double expense = std::stod(PQgetvalue(r, 0, 1));
-      clearRes(r);
-
-      jsonOk(res,
-             {{"income", income},
-              {"expense", expense},
-              {"balance", income - expense}},
-             origin);
+      // Without ?year= the body also depends on today's date.
+      const Compression::Encoding enc = acceptedEncoding(req);
+      const std::string etag = versions.etag(
+          userId, encodedTarget(req, enc) +
+                      (req.has_param("year") ? "" : "#" + std::to_string(year)));
+      if (notModified(req, res, etag, origin)) return;
+
+      auto db = acquireDb(pool, res, origin);
+      if (!db) return;
+
+      std::vector<Rollup::Bucket> buckets;
+      try {
+        buckets = Rollup::fetch(*db, userId, year, *group);
+      } catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return jsonError(res, 500, "DB_ERROR", "Could not fetch rollup", origin);
+      }
+      db = DbPool::Lease();
+
+      Metrics::PhaseTimer serializeTimer(Metrics::Phase::Json);
+      int64_t income = 0, expense = 0, count = 0;
+      std::string body;
+      body.reserve(64 + buckets.size() * 96);
+      JsonWriter w(body);
+      w.beginObject()
+          .key("year").value(static_cast<int64_t>(year))
+          .key("group").value(groupName)
+          .key("buckets").beginArray();
+      for (const Rollup::Bucket& b : buckets) {
+        w.beginObject()
+            .key("key").value(b.key)
+            .key("income").cents(b.incomeCents)
+            .key("expense").cents(b.expenseCents)
+            .key("net").cents(b.incomeCents - b.expenseCents)
+            .key("count").value(b.count)
+            .endObject();
+        income += b.incomeCents;
+        expense += b.expenseCents;
+        count += b.count;
+      }
+      w.endArray()
+          .key("totals").beginObject()
+          .key("income").cents(income)
+          .key("expense").cents(expense)
+          .key("net").cents(income - expense)
+          .key("count").value(count)
+          .endObject()
+          .endObject();
+
+      setEtag(res, etag);
+      sendJson(res, std::move(body), enc, origin);
     });
 
     std::cout << "FlowFund API listening on " << host << ":" << port << "\n";
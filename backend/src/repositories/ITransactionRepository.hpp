@@ -20,6 +20,7 @@ struct TransactionFilters {
   int pageSize = 20;
 
   std::string sort; // date_desc, date_asc, amount_desc, amount_asc
+  std::string cursor; // optional; opaque keyset cursor, used instead of page
 };
 
 struct PagedTransactions {
@@ -28,6 +29,7 @@ struct PagedTransactions {
   int pageSize = 20;
   int totalItems = 0;
   int totalPages = 0;
+  std::string nextCursor; // empty on the last page
 };
 
 class ITransactionRepository {
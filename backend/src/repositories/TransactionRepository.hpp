@@ -1,10 +1,26 @@
 #pragma once
+#include <cstdint>
 #include <vector>
 #include "../models/Transaction.hpp"
 
+// Income and expense totals over every stored transaction, in cents.
+struct TransactionTotals {
+    int64_t incomeCents = 0;
+    int64_t expenseCents = 0;
+};
+
 class TransactionRepository {
 public:
     virtual ~TransactionRepository() = default;
     virtual void save(const Transaction& tx) = 0;
     virtual std::vector<Transaction> findAll() = 0;
+
+    // All-or-nothing where the store supports it.
+    virtual void saveMany(const std::vector<Transaction>& txs) {
+        for (const auto& tx : txs) save(tx);
+    }
+
+    // Aggregates are computed by the store; no rows are loaded.
+    virtual int64_t sumCentsByType(TransactionType type) = 0;
+    virtual TransactionTotals summary() = 0;
 };
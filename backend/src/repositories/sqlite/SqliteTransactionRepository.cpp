@@ -1,28 +1,58 @@
 #include "SqliteTransactionRepository.hpp"
+#include <stdexcept>
 
-SqliteTransactionRepository::SqliteTransactionRepository(Database& db) : db(db) {}
+static const char* kInsertSql =
+    "INSERT INTO transactions(amount,currency,date,type) VALUES(?,?,?,?)";
 
-void SqliteTransactionRepository::save(const Transaction& tx) {
-    sqlite3_stmt* stmt;
-    const char* sql =
-        "INSERT INTO transactions(amount,currency,date,type) VALUES(?,?,?,?)";
-    sqlite3_prepare_v2(db.get(), sql, -1, &stmt, nullptr);
+static void insert(Database& db, sqlite3_stmt* stmt, const Transaction& tx) {
     sqlite3_bind_double(stmt, 1, tx.getAmount());
     sqlite3_bind_text(stmt, 2, tx.getCurrency().c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 3, tx.getDate().c_str(), -1, SQLITE_TRANSIENT);
     sqlite3_bind_text(stmt, 4,
         tx.getType() == TransactionType::INCOME ? "INCOME" : "EXPENSE",
-        -1, SQLITE_TRANSIENT);
-    sqlite3_step(stmt);
-    sqlite3_finalize(stmt);
+        -1, SQLITE_STATIC);
+    if (sqlite3_step(stmt) != SQLITE_DONE)
+        throw std::runtime_error(std::string("insert failed: ") + sqlite3_errmsg(db.get()));
+    sqlite3_reset(stmt);
+}
+
+// The (type, amount) index covers both aggregates below: sumCentsByType
+// is a range search on it and summary() scans it instead of the table.
+static const char* kSchemaSql =
+    "CREATE TABLE IF NOT EXISTS transactions("
+    " id INTEGER PRIMARY KEY AUTOINCREMENT,"
+    " amount REAL NOT NULL,"
+    " currency TEXT NOT NULL,"
+    " date TEXT NOT NULL,"
+    " type TEXT NOT NULL);"
+    "CREATE INDEX IF NOT EXISTS idx_transactions_type_amount"
+    " ON transactions(type, amount);";
+
+SqliteTransactionRepository::SqliteTransactionRepository(Database& db) : db(db) {
+    db.exec(kSchemaSql);
+}
+
+void SqliteTransactionRepository::save(const Transaction& tx) {
+    auto stmt = db.prepare(kInsertSql);
+    insert(db, stmt, tx);
+}
+
+// One transaction for the lot, so the log is synced once, not per row.
+void SqliteTransactionRepository::saveMany(const std::vector<Transaction>& txs) {
+    auto stmt = db.prepare(kInsertSql);
+    db.begin();
+    try {
+        for (const auto& tx : txs) insert(db, stmt, tx);
+        db.commit();
+    } catch (...) {
+        db.rollback();
+        throw;
+    }
 }
 
 std::vector<Transaction> SqliteTransactionRepository::findAll() {
     std::vector<Transaction> list;
-    sqlite3_stmt* stmt;
-    sqlite3_prepare_v2(db.get(),
-        "SELECT id,amount,currency,date,type FROM transactions",
-        -1, &stmt, nullptr);
+    auto stmt = db.prepare("SELECT id,amount,currency,date,type FROM transactions");
 
     while (sqlite3_step(stmt) == SQLITE_ROW) {
         list.emplace_back(
@@ -35,6 +65,35 @@ std::vector<Transaction> SqliteTransactionRepository::findAll() {
                 : TransactionType::EXPENSE
         );
     }
-    sqlite3_finalize(stmt);
     return list;
 }
+
+// amount is a REAL column; each row is rounded to whole cents before
+// summing, so the total is an exact integer sum.
+int64_t SqliteTransactionRepository::sumCentsByType(TransactionType type) {
+    auto stmt = db.prepare(
+        "SELECT COALESCE(SUM(CAST(ROUND(amount*100) AS INTEGER)),0)"
+        " FROM transactions WHERE type=?");
+    sqlite3_bind_text(stmt, 1,
+        type == TransactionType::INCOME ? "INCOME" : "EXPENSE",
+        -1, SQLITE_STATIC);
+    int64_t total = 0;
+    if (sqlite3_step(stmt) == SQLITE_ROW) total = sqlite3_column_int64(stmt, 0);
+    return total;
+}
+
+// Both totals in one pass over idx_transactions_type_amount.
+TransactionTotals SqliteTransactionRepository::summary() {
+    auto stmt = db.prepare(
+        "SELECT COALESCE(SUM(CASE WHEN type='INCOME'"
+        "   THEN CAST(ROUND(amount*100) AS INTEGER) END),0),"
+        " COALESCE(SUM(CASE WHEN type='EXPENSE'"
+        "   THEN CAST(ROUND(amount*100) AS INTEGER) END),0)"
+        " FROM transactions");
+    TransactionTotals totals;
+    if (sqlite3_step(stmt) == SQLITE_ROW) {
+        totals.incomeCents = sqlite3_column_int64(stmt, 0);
+        totals.expenseCents = sqlite3_column_int64(stmt, 1);
+    }
+    return totals;
+}
@@ -7,5 +7,8 @@ class SqliteTransactionRepository : public TransactionRepository {
 public:
     explicit SqliteTransactionRepository(Database& db);
     void save(const Transaction& tx) override;
+    void saveMany(const std::vector<Transaction>& txs) override;
     std::vector<Transaction> findAll() override;
+    int64_t sumCentsByType(TransactionType type) override;
+    TransactionTotals summary() override;
 };
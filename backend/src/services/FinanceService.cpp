@@ -1,4 +1,4 @@
-=#include "FinanceService.hpp"
+#include "FinanceService.hpp"
 #include "../models/Income.hpp"
 #include "../models/Expense.hpp"
 
@@ -11,15 +11,12 @@ void FinanceService::addExpense(double a,const std::string& c,const std::string&
     repo->save(Expense(a,c,d));
 }
 
-double FinanceService::totalIncome(){
-    double t=0; for(auto& x:repo->findAll())
-        if(x.getType()==TransactionType::INCOME) t+=x.getAmount();
-    return t;
+// Totals are summed as integer cents; only the result becomes a double.
+double FinanceService::totalIncome(){ return repo->sumCentsByType(TransactionType::INCOME)/100.0; }
+double FinanceService::totalExpense(){ return repo->sumCentsByType(TransactionType::EXPENSE)/100.0; }
+double FinanceService::balance(){
+    auto t=repo->summary();
+    return (t.incomeCents-t.expenseCents)/100.0;
 }
-double FinanceService::totalExpense(){
-    double t=0; for(auto& x:repo->findAll())
-        if(x.getType()==TransactionType::EXPENSE) t+=x.getAmount();
-    return t;
-}
-double FinanceService::balance(){ return totalIncome()-totalExpense(); }
+TransactionTotals FinanceService::summary(){ return repo->summary(); }
 std::vector<Transaction> FinanceService::all(){ return repo->findAll(); }
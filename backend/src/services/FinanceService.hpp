@@ -13,5 +13,6 @@ public:
     double totalIncome();
     double totalExpense();
     double balance();
+    TransactionTotals summary();
     std::vector<Transaction> all();
 };